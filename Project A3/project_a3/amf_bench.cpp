@@ -1,4 +1,14 @@
 #include <bits/stdc++.h>
+#include <immintrin.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 using namespace std;
 
 // ====================== Utility: Random & Hash ======================
@@ -14,6 +24,18 @@ struct SplitMix64 {
     }
 };
 
+// xorshift64*: a few cycles per draw and no shared state, unlike rand()
+struct Xorshift64 {
+    uint64_t x;
+    Xorshift64(uint64_t seed=1) : x(seed ? seed : 0x9e3779b97f4a7c15ULL) {}
+    uint64_t next() {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        return x * 0x2545f4914f6cdd1dULL;
+    }
+};
+
 inline uint64_t hash64(uint64_t x, uint64_t seed) {
     x ^= seed;
     x += 0x9e3779b97f4a7c15ULL;
@@ -23,13 +45,210 @@ inline uint64_t hash64(uint64_t x, uint64_t seed) {
     return x;
 }
 
-// Quantile helper
+// ====================== Utility: Aligned Storage ======================
+
+// Page backing of the mmap'd tables, in order of preference. A 2 MiB page
+// covers what would take 512 dTLB entries at 4 KiB, so a table probed at
+// random stops missing the dTLB on nearly every lookup. HUGETLB needs
+// pages reserved in /proc/sys/vm/nr_hugepages; THP is only a hint, taken
+// when transparent_hugepage is "madvise" or "always".
+enum class PageBacking { NORMAL, THP, HUGETLB };
+
+constexpr size_t HUGE_PAGE = 2 << 20;
+
+// best backing map_table may try (--pages)
+PageBacking g_page_policy = PageBacking::NORMAL;
+// bytes map_table obtained per backing, since page_stats_reset()
+array<atomic<size_t>, 3> g_page_bytes{};
+
+const char* page_backing_str(PageBacking b) {
+    switch (b) {
+        case PageBacking::NORMAL: return "normal";
+        case PageBacking::THP: return "thp";
+        case PageBacking::HUGETLB: return "hugetlb";
+    }
+    return "unknown";
+}
+
+bool parse_page_backing(const string &s, PageBacking &out) {
+    for (PageBacking b : {PageBacking::NORMAL, PageBacking::THP,
+                          PageBacking::HUGETLB}) {
+        if (s == page_backing_str(b)) {
+            out = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+void page_stats_reset() {
+    for (auto &b : g_page_bytes) b = 0;
+}
+
+// Backing of most of what was mapped since the reset; "none" when every
+// table was small enough for aligned_alloc.
+const char* page_backing_obtained() {
+    int best = -1;
+    size_t most = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (g_page_bytes[i] > most) { most = g_page_bytes[i]; best = i; }
+    }
+    return best < 0 ? "none" : page_backing_str((PageBacking)best);
+}
+
+// Huge-page memory the process has in use, THP plus hugetlbfs, in KiB;
+// -1 without /proc/self/smaps_rollup.
+long huge_page_kb() {
+    ifstream in("/proc/self/smaps_rollup");
+    if (!in) return -1;
+    long kb = 0;
+    string line;
+    while (getline(in, line)) {
+        if (line.rfind("AnonHugePages:", 0) == 0 ||
+            line.rfind("Private_Hugetlb:", 0) == 0) {
+            kb += atol(line.c_str() + line.find(':') + 1);
+        }
+    }
+    return kb;
+}
+
+// Anonymous, zero-filled, lazily faulted mapping of at least `bytes`.
+// Walks down from g_page_policy: MAP_HUGETLB, then a 2 MiB-aligned
+// mapping with madvise(MADV_HUGEPAGE), then plain pages. `bytes` is
+// updated to the length actually mapped, which is what munmap needs.
+void* map_table(size_t &bytes) {
+    size_t huge = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    int prot = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    if (g_page_policy >= PageBacking::HUGETLB) {
+        void* a = mmap(nullptr, huge, prot, flags | MAP_HUGETLB, -1, 0);
+        if (a != MAP_FAILED) {
+            bytes = huge;
+            g_page_bytes[(int)PageBacking::HUGETLB] += huge;
+            return a;
+        }
+    }
+#endif
+#ifdef MADV_HUGEPAGE
+    if (g_page_policy >= PageBacking::THP) {
+        // over-map by one huge page, then trim to an aligned window
+        size_t span = huge + HUGE_PAGE;
+        char* a = (char*)mmap(nullptr, span, prot, flags, -1, 0);
+        if (a != MAP_FAILED) {
+            char* start = (char*)(((uintptr_t)a + HUGE_PAGE - 1) &
+                                  ~(uintptr_t)(HUGE_PAGE - 1));
+            if (start > a) munmap(a, start - a);
+            size_t tail = (size_t)((a + span) - (start + huge));
+            if (tail) munmap(start + huge, tail);
+            if (madvise(start, huge, MADV_HUGEPAGE) == 0) {
+                bytes = huge;
+                g_page_bytes[(int)PageBacking::THP] += huge;
+                return start;
+            }
+            munmap(start, huge);
+        }
+    }
+#endif
+    void* a = mmap(nullptr, bytes, prot, flags, -1, 0);
+    if (a == MAP_FAILED) return nullptr;
+    g_page_bytes[(int)PageBacking::NORMAL] += bytes;
+    return a;
+}
+
+// Zero-initialized, over-aligned array for filter tables. Move-only; T must
+// be trivially copyable. view() instead points it at memory owned by someone
+// else (a mapped filter file), kept alive through `backing`.
+//
+// Tables of LAZY_BYTES or more come straight from an anonymous mmap: the
+// kernel hands out zero pages on first touch, so allocating one costs the
+// same at any size and the page faults are spread over the inserts that
+// touch it. The growable filters rely on this to keep inserts bounded.
+// map_table() picks the page size for that mapping.
 template<typename T>
-T quantile(vector<T> v, double q) {
-    if (v.empty()) return T{};
-    size_t idx = (size_t) floor(q * (v.size() - 1));
-    nth_element(v.begin(), v.begin() + idx, v.end());
-    return v[idx];
+struct AlignedArray {
+    static constexpr size_t LAZY_BYTES = 1 << 20;
+
+    T* ptr;
+    size_t n;
+    shared_ptr<void> backing;  // frees ptr if set; null when ptr is malloc'd
+
+    AlignedArray() : ptr(nullptr), n(0) {}
+    explicit AlignedArray(size_t count, size_t align = 64)
+        : ptr(nullptr), n(0) { assign(count, align); }
+    ~AlignedArray() { release(); }
+
+    AlignedArray(const AlignedArray&) = delete;
+    AlignedArray& operator=(const AlignedArray&) = delete;
+    AlignedArray(AlignedArray&& o) noexcept
+        : ptr(o.ptr), n(o.n), backing(std::move(o.backing)) {
+        o.ptr = nullptr; o.n = 0;
+    }
+    AlignedArray& operator=(AlignedArray&& o) noexcept {
+        if (this != &o) {
+            release();
+            ptr = o.ptr; n = o.n; backing = std::move(o.backing);
+            o.ptr = nullptr; o.n = 0;
+        }
+        return *this;
+    }
+
+    void release() {
+        if (!backing) free(ptr);
+        backing.reset();
+        ptr = nullptr;
+        n = 0;
+    }
+
+    void view(T* p, size_t count, shared_ptr<void> owner) {
+        release();
+        ptr = p;
+        n = count;
+        backing = std::move(owner);
+    }
+
+    void assign(size_t count, size_t align = 64) {
+        release();
+        size_t bytes = (count * sizeof(T) + align - 1) / align * align;
+        if (bytes == 0) bytes = align;
+        if (bytes >= LAZY_BYTES && align <= 4096) {
+            void* addr = map_table(bytes);
+            if (!addr) throw bad_alloc();
+            backing = shared_ptr<void>(addr, [bytes](void* p) {
+                munmap(p, bytes);
+            });
+            ptr = (T*)addr;
+            n = count;
+            return;
+        }
+        ptr = (T*)aligned_alloc(align, bytes);
+        if (!ptr) throw bad_alloc();
+        memset(ptr, 0, bytes);
+        n = count;
+    }
+
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+    size_t size() const { return n; }
+    T* begin() { return ptr; }
+    T* end() { return ptr + n; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + n; }
+};
+
+// Runs fn(tid) for tid in [0, threads); inline when threads <= 1.
+template<typename Fn>
+void parallel_run(int threads, Fn &&fn) {
+    if (threads <= 1) {
+        fn(0);
+        return;
+    }
+    vector<thread> ts;
+    ts.reserve(threads);
+    for (int t = 0; t < threads; ++t) ts.emplace_back(fn, t);
+    for (auto &th : ts) th.join();
 }
 
 // mean/std helpers for error bars
@@ -52,13 +271,513 @@ double stddev_vec(const vector<double>& v) {
     return (double) sqrt(s / (n - 1));
 }
 
+// ====================== Utility: Fingerprint Storage ======================
+//
+// FingerprintArray<W> holds W-bit fingerprints (4 <= W <= 16). W = 8 and
+// W = 16 are plain byte / halfword arrays; any other width is bit-packed
+// into 64-bit words so an entry costs exactly W bits. Packed entries are
+// read and written through an unaligned 64-bit window at byte granularity,
+// which reaches 57 bits past any entry; one spare word at the end keeps
+// the window inside the allocation.
+
+template<unsigned W>
+struct FingerprintArray {
+    static_assert(W >= 4 && W <= 16, "fingerprint width must be 4..16 bits");
+    static constexpr bool PACKED = (W != 8 && W != 16);
+    static constexpr uint64_t MASK = (1ULL << W) - 1;
+    using word_t = conditional_t<W == 8, uint8_t,
+                   conditional_t<W == 16, uint16_t, uint64_t>>;
+
+    AlignedArray<word_t> data;
+    size_t n = 0;
+
+    static size_t words_for(size_t count) {
+        return PACKED ? (count * W + 63) / 64 + 1 : count;
+    }
+
+    void assign(size_t count) {
+        n = count;
+        data.assign(words_for(count));
+    }
+
+    // entries [i, i + count) with entry i in the low bits; count * W <= 57
+    inline uint64_t window(size_t i, unsigned count) const {
+        if constexpr (!PACKED) {
+            uint64_t w = 0;
+            memcpy(&w, &data[i], count * sizeof(word_t));
+            return w;
+        } else {
+            size_t bit = i * W;
+            uint64_t w;
+            memcpy(&w, (const char*)data.data() + (bit >> 3), sizeof(w));
+            return (w >> (bit & 7)) & ((1ULL << (count * W)) - 1);
+        }
+    }
+
+    inline uint16_t get(size_t i) const {
+        if constexpr (!PACKED) return data[i];
+        else return (uint16_t)window(i, 1);
+    }
+
+    inline void set(size_t i, uint16_t v) {
+        if constexpr (!PACKED) {
+            data[i] = (word_t)v;
+        } else {
+            size_t bit = i * W;
+            char* p = (char*)data.data() + (bit >> 3);
+            unsigned sh = bit & 7;
+            uint64_t w;
+            memcpy(&w, p, sizeof(w));
+            w = (w & ~(MASK << sh)) | ((uint64_t)(v & MASK) << sh);
+            memcpy(p, &w, sizeof(w));
+        }
+    }
+
+    const void* addr(size_t i) const {
+        return (const char*)data.data() + (i * W >> 3);
+    }
+
+    size_t size() const { return n; }
+    size_t bytes() const { return data.size() * sizeof(word_t); }
+};
+
+// ====================== Utility: Timing ======================
+//
+// Op latencies come from the TSC: an lfence-ordered rdtsc to start and
+// rdtscp (which waits for the timed work to retire) to stop. TscClock
+// calibrates ticks against steady_clock once per process and measures the
+// cost of an empty start/stop pair, which is subtracted from every sample.
+// Without a TSC the same calls return steady_clock nanoseconds.
+
+#if defined(__x86_64__) || defined(__i386__)
+inline uint64_t tsc_start() {
+    _mm_lfence();
+    return __rdtsc();
+}
+
+inline uint64_t tsc_stop() {
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+#else
+inline uint64_t tsc_start() {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64_t tsc_stop() { return tsc_start(); }
+#endif
+
+struct TscClock {
+    double ns_per_tick;
+    uint64_t overhead;   // ticks of an empty start/stop pair
+
+    static const TscClock &get() {
+        static const TscClock clock;
+        return clock;
+    }
+
+private:
+    TscClock() : ns_per_tick(1.0), overhead(~0ULL) {
+        using namespace std::chrono;
+        auto w0 = steady_clock::now();
+        uint64_t t0 = tsc_start();
+        while (steady_clock::now() - w0 < milliseconds(20)) {}
+        uint64_t t1 = tsc_stop();
+        double ns = (double)duration_cast<nanoseconds>(
+            steady_clock::now() - w0).count();
+        if (t1 > t0) ns_per_tick = ns / (double)(t1 - t0);
+
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t a = tsc_start();
+            overhead = min(overhead, tsc_stop() - a);
+        }
+    }
+};
+
+// time 1 op in every g_sample_every (--sample=N) ...
+size_t g_sample_every = 8;
+// ... as a span of g_sample_span consecutive ops charged evenly (--span=K)
+size_t g_sample_span = 1;
+
+// Fixed-memory log-linear histogram in the HdrHistogram layout: values
+// below 2^SUB_BITS get a bucket each, and every power-of-two range above
+// is split into 2^(SUB_BITS-1) equal buckets, so a quantile is off by at
+// most 1/64 of its value. Values past 2^MAX_BITS land in the last bucket;
+// the exact maximum is kept on the side.
+struct LatencyHistogram {
+    static constexpr int SUB_BITS = 7;
+    static constexpr int MAX_BITS = 40;
+    static constexpr size_t HALF = (size_t)1 << (SUB_BITS - 1);
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 2) * HALF;
+
+    array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    static size_t index_of(uint64_t v) {
+        if (v < 2 * HALF) return (size_t)v;
+        int k = 63 - __builtin_clzll(v) - SUB_BITS + 1;
+        if (k > MAX_BITS - SUB_BITS) return BUCKETS - 1;
+        return (size_t)k * HALF + (size_t)(v >> k);
+    }
+
+    // midpoint of the bucket's range
+    static uint64_t value_at(size_t idx) {
+        if (idx < 2 * HALF) return idx;
+        size_t k = idx / HALF - 1;
+        uint64_t lo = (uint64_t)(idx - k * HALF) << k;
+        return lo + ((1ULL << k) >> 1);
+    }
+
+    void record(uint64_t v, uint64_t n = 1) {
+        counts[index_of(v)] += n;
+        total += n;
+        max_value = max(max_value, v);
+    }
+
+    void merge(const LatencyHistogram &o) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts[i] += o.counts[i];
+        total += o.total;
+        max_value = max(max_value, o.max_value);
+    }
+
+    uint64_t quantile(double q) const {
+        if (total == 0) return 0;
+        if (q >= 1.0) return max_value;
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(q * (double)total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return min(value_at(i), max_value);
+        }
+        return max_value;
+    }
+};
+
+// ====================== Utility: Hardware Counters ======================
+//
+// PerfCounters counts cycles, instructions, L1D/LLC/dTLB misses and branch
+// misses around a measured phase via perf_event_open. The events follow
+// the calling thread and, through `inherit`, every thread it starts during
+// the phase; user space only, so perf_event_paranoid 2 is enough.
+// Inherited events can't be read as a group, so each event is its own
+// leader: when they outnumber the PMU counters the kernel time-slices
+// them and each count is scaled by time_enabled / time_running. `scale`
+// keeps the largest factor applied (1 = never multiplexed). Events that
+// can't be opened (no PMU in a VM, seccomp, non-Linux) read as NaN.
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_N_EVENTS
+};
+
+struct PerfCounters {
+    bool enabled;
+    array<int, PERF_N_EVENTS> fds;
+    array<double, PERF_N_EVENTS> totals{};
+    array<uint64_t, PERF_N_EVENTS> running{};  // ns each event was counting
+    double scale = 1.0;
+    int open_errno = 0;                        // first failure, for reporting
+
+    explicit PerfCounters(bool enable) : enabled(enable) { fds.fill(-1); }
+    ~PerfCounters() { close_all(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Counters are opened per phase rather than reset: RESET clears only
+    // the parent's count, not what exited child threads folded into it.
+    void start() {
+        if (!enabled) return;
+#ifdef __linux__
+        auto cache = [](uint64_t c) {
+            return c | ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        const pair<uint32_t, uint64_t> events[PERF_N_EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (int i = 0; i < PERF_N_EVENTS; ++i) {
+            perf_event_attr a;
+            memset(&a, 0, sizeof(a));
+            a.size = sizeof(a);
+            a.type = events[i].first;
+            a.config = events[i].second;
+            a.disabled = 1;
+            a.inherit = 1;
+            a.exclude_kernel = 1;
+            a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+            if (fds[i] < 0 && open_errno == 0) open_errno = errno;
+        }
+        for (int fd : fds)
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (int fd : fds)
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < PERF_N_EVENTS; ++i) {
+            uint64_t v[3];  // value, time_enabled, time_running
+            if (fds[i] < 0 || read(fds[i], v, sizeof(v)) != sizeof(v)) continue;
+            if (v[2] == 0) continue;
+            double s = (double)v[1] / (double)v[2];
+            totals[i] += (double)v[0] * s;
+            running[i] += v[2];
+            scale = max(scale, s);
+        }
+#endif
+        close_all();
+    }
+
+    template<typename Fn>
+    auto measure(Fn &&fn) -> decltype(fn()) {
+        start();
+        auto r = fn();
+        stop();
+        return r;
+    }
+
+    bool available() const {
+        for (uint64_t r : running) if (r) return true;
+        return false;
+    }
+
+    // accumulated count per op; NaN if the event never got to count
+    double per_op(PerfEvent e, double ops) const {
+        if (running[e] == 0 || ops <= 0) return NAN;
+        return totals[e] / ops;
+    }
+
+    static const char *csv_header() {
+        return "cycles_per_op,instructions_per_op,l1d_misses_per_op,"
+               "llc_misses_per_op,dtlb_misses_per_op,branch_misses_per_op,"
+               "perf_scale";
+    }
+
+    void write_csv(ostream &os, double ops) const {
+        for (int i = 0; i < PERF_N_EVENTS; ++i)
+            os << per_op((PerfEvent)i, ops) << ",";
+        os << (available() ? scale : (double)NAN);
+    }
+
+private:
+    void close_all() {
+        for (int &fd : fds) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+};
+
+// ====================== Utility: CPU Topology ======================
+//
+// Thread placement for the scaling harness. CpuTopology reads package and
+// core ids from /sys/devices/system/cpu for the CPUs in the process's
+// affinity mask, and a placement turns them into the order worker t is
+// pinned from (wrapping when there are more workers than CPUs):
+//   compact   - package by package, one thread per physical core before
+//               any SMT sibling
+//   scatter   - round-robin over packages, one per physical core first
+//   smt_first - both siblings of a core before moving to the next core
+//   list      - an explicit CPU list, e.g. 0,2,4-7
+// none leaves the threads to the OS scheduler.
+
+enum class Placement { NONE, COMPACT, SCATTER, SMT_FIRST, LIST };
+
+struct PlacementSpec {
+    Placement kind = Placement::NONE;
+    vector<int> cpus;   // for LIST
+};
+
+struct CpuInfo {
+    int cpu;
+    int package;
+    int core;   // rank of the physical core within its package
+    int smt;    // rank of the cpu among its core's siblings
+};
+
+inline int read_sysfs_int(const string &path, int fallback) {
+    ifstream in(path);
+    int v;
+    return (in >> v) ? v : fallback;
+}
+
+struct CpuTopology {
+    vector<CpuInfo> cpus;   // sorted by cpu id
+
+    static const CpuTopology &get() {
+        static const CpuTopology topo;
+        return topo;
+    }
+
+    size_t physical_cores() const {
+        set<pair<int, int>> cores;
+        for (auto &c : cpus) cores.insert({c.package, c.core});
+        return cores.size();
+    }
+
+private:
+    CpuTopology() {
+        vector<int> allowed;
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (CPU_ISSET(c, &mask)) allowed.push_back(c);
+        }
+#endif
+        if (allowed.empty()) {
+            int hc = max(1, (int)thread::hardware_concurrency());
+            for (int c = 0; c < hc; ++c) allowed.push_back(c);
+        }
+
+        // raw core_id is only unique within a package and may be sparse
+        map<pair<int, int>, vector<int>> siblings;
+        map<int, set<int>> package_cores;
+        vector<pair<int, int>> raw;
+        for (int c : allowed) {
+            string dir = "/sys/devices/system/cpu/cpu" + to_string(c) +
+                         "/topology/";
+            int pkg = read_sysfs_int(dir + "physical_package_id", 0);
+            int core = read_sysfs_int(dir + "core_id", c);
+            raw.push_back({pkg, core});
+            siblings[{pkg, core}].push_back(c);
+            package_cores[pkg].insert(core);
+        }
+        for (size_t i = 0; i < allowed.size(); ++i) {
+            auto [pkg, core] = raw[i];
+            auto &sib = siblings[{pkg, core}];
+            auto &pc = package_cores[pkg];
+            CpuInfo info;
+            info.cpu = allowed[i];
+            info.package = pkg;
+            info.core = (int)distance(pc.begin(), pc.find(core));
+            info.smt = (int)(find(sib.begin(), sib.end(), allowed[i]) -
+                             sib.begin());
+            cpus.push_back(info);
+        }
+    }
+};
+
+string placement_str(const PlacementSpec &p) {
+    switch (p.kind) {
+        case Placement::NONE:      return "none";
+        case Placement::COMPACT:   return "compact";
+        case Placement::SCATTER:   return "scatter";
+        case Placement::SMT_FIRST: return "smt_first";
+        case Placement::LIST:      return "list";
+    }
+    return "unknown";
+}
+
+// "none", "compact", "scatter", "smt_first" or a list like "0,2,4-7"
+bool parse_placement(const string &s, PlacementSpec &out) {
+    out = PlacementSpec();
+    if (s == "none") return true;
+    if (s == "compact")   { out.kind = Placement::COMPACT;   return true; }
+    if (s == "scatter")   { out.kind = Placement::SCATTER;   return true; }
+    if (s == "smt_first") { out.kind = Placement::SMT_FIRST; return true; }
+
+    out.kind = Placement::LIST;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t dash = item.find('-');
+        try {
+            int lo = stoi(item.substr(0, dash));
+            int hi = dash == string::npos ? lo : stoi(item.substr(dash + 1));
+            if (lo < 0 || hi < lo) return false;
+            for (int c = lo; c <= hi; ++c) out.cpus.push_back(c);
+        } catch (const exception &) {
+            return false;
+        }
+    }
+    return !out.cpus.empty();
+}
+
+// CPU for worker t is order[t % order.size()]; empty for NONE
+vector<int> placement_order(const PlacementSpec &p) {
+    if (p.kind == Placement::NONE) return {};
+    if (p.kind == Placement::LIST) return p.cpus;
+
+    vector<CpuInfo> cpus = CpuTopology::get().cpus;
+    auto key = [&](const CpuInfo &c) {
+        switch (p.kind) {
+            case Placement::COMPACT:
+                return make_tuple(c.package, c.smt, c.core, c.cpu);
+            case Placement::SCATTER:
+                return make_tuple(c.smt, c.core, c.package, c.cpu);
+            default:
+                return make_tuple(c.package, c.core, c.smt, c.cpu);
+        }
+    };
+    stable_sort(cpus.begin(), cpus.end(),
+                [&](const CpuInfo &a, const CpuInfo &b) { return key(a) < key(b); });
+    vector<int> order;
+    for (auto &c : cpus) order.push_back(c.cpu);
+    return order;
+}
+
+// CPUs the first `threads` workers land on, e.g. "0;2;4" ("os" for none)
+string placement_cpus_str(const PlacementSpec &p, int threads) {
+    vector<int> order = placement_order(p);
+    if (order.empty()) return "os";
+    string s;
+    for (int t = 0; t < threads; ++t) {
+        if (t) s += ";";
+        s += to_string(order[(size_t)t % order.size()]);
+    }
+    return s;
+}
+
+inline bool pin_current_thread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
 // ====================== Common Filter Interface ======================
 
-enum class FilterType {
-    BLOOM_BLOCKED,
-    CUCKOO,
-    QUOTIENT,
-    XOR_FILTER
+// The values are the type tags of saved filter images: never renumber,
+// append new types with the next free value.
+enum class FilterType : uint32_t {
+    BLOOM_BLOCKED     = 0,
+    BLOOM_SPLIT       = 1,
+    BLOOM_CONCURRENT  = 2,
+    CUCKOO            = 3,
+    CUCKOO_CONCURRENT = 4,
+    QUOTIENT          = 5,
+    RSQF              = 6,
+    XOR_FILTER        = 7,
+    BINARY_FUSE       = 8,
+    BLOOM_SCALABLE    = 9,
+    CUCKOO_GROWING    = 10,
+    RIBBON            = 11
 };
 
 struct ApproxFilter {
@@ -67,15 +786,192 @@ struct ApproxFilter {
     virtual bool contains(uint64_t key) const = 0;
     virtual bool erase(uint64_t key) = 0;
     virtual size_t bytes_used() const = 0;
+
+    // out[i] = contains(keys[i]). Filters with a vectorized lookup kernel
+    // override this; the default is just the scalar loop.
+    virtual void contains_batch(const uint64_t* keys, size_t n,
+                                uint8_t* out) const {
+        for (size_t i = 0; i < n; ++i) out[i] = contains(keys[i]) ? 1 : 0;
+    }
+};
+
+// Construction report for the static filters.
+struct BuildStats {
+    double build_ms = 0.0;
+    size_t peak_bytes = 0;  // table plus construction scratch alive at once
+    int threads = 1;
+    int attempts = 0;       // seeds tried before peeling succeeded
+};
+
+// ====================== On-Disk Filter Images ======================
+//
+// Layout: one 4 KiB page holding FilterFileHeader, then each payload
+// array starting on its own page boundary. FILTER_FORMAT_VERSION goes up
+// whenever a filter's saved arrays or params change meaning (2: quotient
+// slots carry their probe distance, n_tomb saved; 3: cuckoo/XOR width in
+// params, bit-packed fingerprints and quotient slots). Scalars are stored
+// in host byte order; the magic/version check rejects anything else we wrote.
+// load_mmap<F>() maps the file MAP_PRIVATE and points the filter's tables
+// straight into the mapping: nothing is copied, pages fault in on first
+// touch, and inserts into a loaded dynamic filter are copy-on-write, so the
+// file itself is never modified.
+
+constexpr char FILTER_MAGIC[8] = {'A', 'M', 'F', 'I', 'L', 'T', 'E', 'R'};
+constexpr uint32_t FILTER_FORMAT_VERSION = 3;
+constexpr size_t FILTER_PAGE = 4096;
+constexpr size_t FILTER_MAX_ARRAYS = 4;
+
+struct FilterFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t type;          // FilterType
+    uint64_t seed[2];
+    uint32_t fp_bits;       // fingerprint / remainder bits, 0 if n/a
+    uint32_t n_arrays;
+    uint64_t params[8];     // filter-specific sizes, see each save()
+    struct {
+        uint64_t offset;    // from file start, page aligned
+        uint64_t bytes;
+    } arrays[FILTER_MAX_ARRAYS];
+};
+static_assert(sizeof(FilterFileHeader) <= FILTER_PAGE, "header must fit a page");
+
+inline FilterFileHeader filter_header(FilterType ft) {
+    FilterFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FILTER_MAGIC, sizeof(h.magic));
+    h.version = FILTER_FORMAT_VERSION;
+    h.type = (uint32_t)ft;
+    return h;
+}
+
+struct FilterPayload {
+    const void* data;
+    size_t bytes;
+};
+
+// Writes header + arrays; fills in the array table of h. Returns false on
+// any I/O error (the partial file is removed).
+bool write_filter_file(const string &path, FilterFileHeader h,
+                       const vector<FilterPayload> &arrays)
+{
+    if (arrays.size() > FILTER_MAX_ARRAYS) return false;
+    h.n_arrays = (uint32_t)arrays.size();
+    uint64_t off = FILTER_PAGE;
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        h.arrays[i].offset = off;
+        h.arrays[i].bytes = arrays[i].bytes;
+        off += (arrays[i].bytes + FILTER_PAGE - 1) / FILTER_PAGE * FILTER_PAGE;
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    vector<char> page(FILTER_PAGE, 0);
+    memcpy(page.data(), &h, sizeof(h));
+    bool ok = fwrite(page.data(), 1, FILTER_PAGE, f) == FILTER_PAGE;
+    memset(page.data(), 0, FILTER_PAGE);
+    for (size_t i = 0; ok && i < arrays.size(); ++i) {
+        size_t b = arrays[i].bytes;
+        size_t pad = (FILTER_PAGE - b % FILTER_PAGE) % FILTER_PAGE;
+        ok = fwrite(arrays[i].data, 1, b, f) == b;
+        if (ok && pad) ok = fwrite(page.data(), 1, pad, f) == pad;
+    }
+    ok = (fflush(f) == 0) && ok;
+    ok = (fsync(fileno(f)) == 0) && ok;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) remove(path.c_str());
+    return ok;
+}
+
+// A mapped filter file. Arrays bound from it share ownership of the
+// mapping, so the image itself may go away once the filter is built.
+struct FilterImage {
+    FilterFileHeader h;
+    shared_ptr<void> mapping;
+    size_t length = 0;
+
+    bool open(const string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < FILTER_PAGE) {
+            close(fd);
+            return false;
+        }
+        length = (size_t)st.st_size;
+        void* addr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return false;
+        size_t len = length;
+        mapping = shared_ptr<void>(addr, [len](void* p) { munmap(p, len); });
+
+        memcpy(&h, addr, sizeof(h));
+        if (memcmp(h.magic, FILTER_MAGIC, sizeof(h.magic)) != 0 ||
+            h.version != FILTER_FORMAT_VERSION ||
+            h.n_arrays > FILTER_MAX_ARRAYS) {
+            mapping.reset();
+            return false;
+        }
+        for (uint32_t i = 0; i < h.n_arrays; ++i) {
+            if (h.arrays[i].offset % FILTER_PAGE != 0 ||
+                h.arrays[i].offset + h.arrays[i].bytes > length) {
+                mapping.reset();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Type, array count and the exact byte size of every array.
+    bool is(FilterType ft, const vector<size_t> &array_bytes) const {
+        if (h.type != (uint32_t)ft || h.n_arrays != array_bytes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < array_bytes.size(); ++i) {
+            if (h.arrays[i].bytes != array_bytes[i]) return false;
+        }
+        return true;
+    }
+
+    template<typename T>
+    void bind(AlignedArray<T> &a, uint32_t idx) const {
+        char* base = (char*)mapping.get() + h.arrays[idx].offset;
+        a.view((T*)base, h.arrays[idx].bytes / sizeof(T), mapping);
+    }
 };
 
+// Opens a file written by F::save(). Returns null if the file is missing,
+// corrupt, or holds a different filter type/configuration.
+template<typename F>
+unique_ptr<F> load_mmap(const string &path) {
+    FilterImage img;
+    if (!img.open(path) || !F::image_matches(img)) return nullptr;
+    return unique_ptr<F>(new F(img));
+}
+
 // ====================== Blocked Bloom Filter ======================
+//
+// A key picks one block of block_bits bits and sets k bits inside it. The
+// i-th bit is the top log2(block_bits) bits of a 32-bit hash half times the
+// i-th odd salt, so the k positions are independent draws rather than
+// points of one arithmetic progression.
+
+// odd multipliers for in-block bit positions, also the split-block lane
+// salts; the first 8 are the ones from the Parquet spec
+alignas(64) static constexpr uint32_t BLOOM_SALT[16] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+    0x9e3779b1U, 0x85ebca77U, 0xc2b2ae3dU, 0x27d4eb2fU,
+    0x165667b1U, 0xd3a2646dU, 0xfd7046c5U, 0xb55a4f09U
+};
 
-struct BlockedBloomFilter : public ApproxFilter {
+struct BlockedBloomFilter final : public ApproxFilter {
     size_t m_bits;
     size_t k_hashes;
     size_t block_bits;  // e.g. 512 bits, must be power of 2
-    vector<uint64_t> bits;
+    size_t block_shift; // 32 - log2(block_bits)
+    AlignedArray<uint64_t> bits;
     uint64_t seed1, seed2;
 
     BlockedBloomFilter(size_t n, double target_fpr,
@@ -83,6 +979,12 @@ struct BlockedBloomFilter : public ApproxFilter {
                        uint64_t s1 = 1, uint64_t s2 = 2)
         : block_bits(block_bits_), seed1(s1), seed2(s2)
     {
+        if (block_bits == 0 || block_bits > (1ULL << 32) ||
+            (block_bits & (block_bits - 1))) {
+            throw invalid_argument("block_bits must be a power of 2");
+        }
+        block_shift = 32 - (size_t)__builtin_ctzll(block_bits);
+
         double m_real = - (double)n * log(target_fpr) /
                         (log(2.0) * log(2.0));
         m_bits = (size_t)ceil(m_real);
@@ -92,9 +994,42 @@ struct BlockedBloomFilter : public ApproxFilter {
 
         double bpe = (double)m_bits / (double)n;
         k_hashes = (size_t)max(1.0, round(bpe * log(2.0)));
+        k_hashes = min<size_t>(k_hashes, 32);  // two 32-bit halves x 16 salts
 
         size_t words = (m_bits + 63) / 64;
-        bits.assign(words, 0);
+        bits.assign(words);
+    }
+
+    // ---- persistence ----
+    // params: m_bits, k_hashes, block_bits; arrays: bits
+    explicit BlockedBloomFilter(const FilterImage &img)
+        : m_bits(img.h.params[0]), k_hashes(img.h.params[1]),
+          block_bits(img.h.params[2]),
+          block_shift(32 - (size_t)__builtin_ctzll(img.h.params[2])),
+          seed1(img.h.seed[0]), seed2(img.h.seed[1])
+    {
+        img.bind(bits, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        if (p[0] == 0 || p[1] > 32 || p[2] == 0 || p[2] > (1ULL << 32) ||
+            (p[2] & (p[2] - 1)) || p[0] % p[2]) {
+            return false;
+        }
+        return img.is(FilterType::BLOOM_BLOCKED, {(p[0] + 63) / 64 * 8});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::BLOOM_BLOCKED);
+        h.seed[0] = seed1;
+        h.seed[1] = seed2;
+        h.params[0] = m_bits;
+        h.params[1] = k_hashes;
+        h.params[2] = block_bits;
+        return write_filter_file(path, h, {
+            {bits.data(), bits.size() * sizeof(uint64_t)}
+        });
     }
 
     inline void set_bit(size_t pos) {
@@ -104,19 +1039,21 @@ struct BlockedBloomFilter : public ApproxFilter {
         return (bits[pos >> 6] >> (pos & 63)) & 1ULL;
     }
 
+    // offset of the i-th bit inside the key's block
+    inline size_t bit_offset(uint64_t h2, size_t i) const {
+        uint32_t h = (uint32_t)(h2 >> (i & 16 ? 32 : 0));
+        return (size_t)((h * BLOOM_SALT[i & 15]) >> block_shift);
+    }
+
     bool insert(uint64_t key) override {
         uint64_t h1 = hash64(key, seed1);
         uint64_t h2 = hash64(key, seed2);
         size_t n_blocks = m_bits / block_bits;
         size_t block = (size_t)(h1 % n_blocks);
         size_t base = block * block_bits;
-        size_t mask = block_bits - 1;
 
         for (size_t i = 0; i < k_hashes; ++i) {
-            uint64_t h = h2 + i * 0x9e3779b97f4a7c15ULL;
-            size_t offset = (size_t)(h & mask);
-            size_t pos = base + offset;
-            set_bit(pos);
+            set_bit(base + bit_offset(h2, i));
         }
         return true;
     }
@@ -127,17 +1064,80 @@ struct BlockedBloomFilter : public ApproxFilter {
         size_t n_blocks = m_bits / block_bits;
         size_t block = (size_t)(h1 % n_blocks);
         size_t base = block * block_bits;
-        size_t mask = block_bits - 1;
 
         for (size_t i = 0; i < k_hashes; ++i) {
-            uint64_t h = h2 + i * 0x9e3779b97f4a7c15ULL;
-            size_t offset = (size_t)(h & mask);
-            size_t pos = base + offset;
-            if (!get_bit(pos)) return false;
+            if (!get_bit(base + bit_offset(h2, i))) return false;
         }
         return true;
     }
 
+    // ---- batched lookup ----
+    // Keys are hashed BATCH at a time and their blocks prefetched; each key's
+    // k bit positions are then folded into a block-sized mask and tested
+    // against the block with one vector compare (no per-bit branches).
+    static constexpr size_t BATCH = 8;
+
+    static inline bool block_covers(const uint64_t* blk, const uint64_t* mask,
+                                    size_t block_words) {
+#if defined(__AVX512F__)
+        if (block_words == 8) {
+            __m512i b = _mm512_loadu_si512((const void*)blk);
+            __m512i m = _mm512_load_si512((const void*)mask);
+            return _mm512_cmpneq_epi64_mask(_mm512_and_si512(b, m), m) == 0;
+        }
+#endif
+#if defined(__AVX2__)
+        if (block_words == 8) {
+            __m256i b0 = _mm256_loadu_si256((const __m256i*)blk);
+            __m256i b1 = _mm256_loadu_si256((const __m256i*)(blk + 4));
+            __m256i m0 = _mm256_load_si256((const __m256i*)mask);
+            __m256i m1 = _mm256_load_si256((const __m256i*)(mask + 4));
+            return _mm256_testc_si256(b0, m0) & _mm256_testc_si256(b1, m1);
+        }
+        if (block_words == 4) {
+            __m256i b = _mm256_loadu_si256((const __m256i*)blk);
+            __m256i m = _mm256_load_si256((const __m256i*)mask);
+            return _mm256_testc_si256(b, m);
+        }
+#endif
+        uint64_t miss = 0;
+        for (size_t w = 0; w < block_words; ++w) miss |= mask[w] & ~blk[w];
+        return miss == 0;
+    }
+
+    void contains_batch(const uint64_t* keys, size_t n,
+                        uint8_t* out) const override {
+        // the mask lives in registers/stack, so only blocks up to 512 bits
+        // made of whole words take the fast path
+        if (block_bits % 64 != 0 || block_bits > 512) {
+            ApproxFilter::contains_batch(keys, n, out);
+            return;
+        }
+        size_t n_blocks = m_bits / block_bits;
+        size_t block_words = block_bits / 64;
+        size_t word_base[BATCH];
+        uint64_t h2s[BATCH];
+
+        for (size_t i = 0; i < n; i += BATCH) {
+            size_t g = min(BATCH, n - i);
+            for (size_t j = 0; j < g; ++j) {
+                uint64_t h1 = hash64(keys[i + j], seed1);
+                h2s[j] = hash64(keys[i + j], seed2);
+                word_base[j] = (size_t)(h1 % n_blocks) * block_words;
+                __builtin_prefetch(&bits[word_base[j]]);
+            }
+            for (size_t j = 0; j < g; ++j) {
+                alignas(64) uint64_t qmask[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+                for (size_t t = 0; t < k_hashes; ++t) {
+                    size_t offset = bit_offset(h2s[j], t);
+                    qmask[offset >> 6] |= 1ULL << (offset & 63);
+                }
+                out[i + j] = block_covers(&bits[word_base[j]], qmask,
+                                          block_words) ? 1 : 0;
+            }
+        }
+    }
+
     bool erase(uint64_t) override {
         return false; // no deletes
     }
@@ -147,65 +1147,496 @@ struct BlockedBloomFilter : public ApproxFilter {
     }
 };
 
-// ====================== Cuckoo Filter ======================
+// ====================== Concurrent Blocked Bloom Filter ======================
+//
+// Same block layout as BlockedBloomFilter, with the words held as atomics
+// so inserts from many threads need no lock: bits only ever go from 0 to 1
+// and ORs commute. Bit positions come from the same BLOOM_SALT products, so
+// a key lands on the same bits in both filters. An insert folds its k bits
+// into per-word masks and issues one relaxed fetch_or per word it touches
+// (skipped when the bits are already there, which keeps hot lines shared).
+// Lookups are relaxed loads.
+
+struct ConcurrentBloomFilter final : public ApproxFilter {
+    size_t m_bits;
+    size_t k_hashes;
+    size_t block_bits;  // power of 2, 64..512
+    size_t block_shift; // 32 - log2(block_bits)
+    size_t n_words;
+    unique_ptr<atomic<uint64_t>[]> bits;
+    uint64_t seed1, seed2;
 
-struct CuckooFilter : public ApproxFilter {
-    struct Bucket {
-        vector<uint16_t> slots; // 0 means empty
-        Bucket(size_t k = 4) : slots(k, 0) {}
-    };
+    ConcurrentBloomFilter(size_t n, double target_fpr,
+                          size_t block_bits_ = 512,
+                          uint64_t s1 = 1, uint64_t s2 = 2)
+        : block_bits(block_bits_), seed1(s1), seed2(s2)
+    {
+        // masks[] holds at most 8 words, and a block must be whole words
+        if (block_bits < 64 || block_bits > 512 ||
+            (block_bits & (block_bits - 1))) {
+            throw invalid_argument("block_bits must be a power of 2 in 64..512");
+        }
+        block_shift = 32 - (size_t)__builtin_ctzll(block_bits);
 
-    size_t bucket_count;
-    size_t bucket_size;
-    size_t fp_bits;
-    uint16_t fp_mask;
-    vector<Bucket> table;
-    uint64_t seed_main;
-    size_t max_kicks;
-    size_t failures;
-    size_t stash_size;
-    vector<uint16_t> stash;
+        double m_real = - (double)n * log(target_fpr) /
+                        (log(2.0) * log(2.0));
+        m_bits = (size_t)ceil(m_real);
 
-    // dynamic stats
-    size_t insert_calls;
-    size_t total_kicks;
-    size_t stash_inserts;
+        size_t blocks = (m_bits + block_bits - 1) / block_bits;
+        m_bits = blocks * block_bits;
 
-    CuckooFilter(size_t n, double target_fpr,
-                 size_t bucket_size_ = 4,
-                 size_t fp_bits_hint = 8,
-                 uint64_t seed = 3,
-                 size_t max_kicks_ = 500)
-        : bucket_size(bucket_size_),
-          seed_main(seed),
-          max_kicks(max_kicks_),
-          failures(0),
-          stash_size(0),
-          insert_calls(0),
-          total_kicks(0),
-          stash_inserts(0)
-    {
-        int f_from_p = (int)ceil(-log2(target_fpr * bucket_size_));
-        int f = (int)fp_bits_hint;
-        if (f_from_p > 0) f = max(f, f_from_p);
-        f = max(4, min(16, f));
-        fp_bits = (size_t)f;
-        fp_mask = (uint16_t)((1u << fp_bits) - 1u);
+        double bpe = (double)m_bits / (double)n;
+        k_hashes = (size_t)max(1.0, round(bpe * log(2.0)));
+        k_hashes = min<size_t>(k_hashes, 32);  // two 32-bit halves x 16 salts
 
-        double lf = 0.9;
-        double buckets_f = (double)n / (lf * (double)bucket_size);
+        n_words = (m_bits + 63) / 64;
+        bits.reset(new atomic<uint64_t>[n_words]);
+        for (size_t i = 0; i < n_words; ++i) bits[i].store(0);
+    }
+
+    // Builds the per-word bit masks of key's k positions in its block;
+    // returns the index of the block's first word.
+    inline size_t key_masks(uint64_t key, uint64_t *masks) const {
+        uint64_t h1 = hash64(key, seed1);
+        uint64_t h2 = hash64(key, seed2);
+        size_t n_blocks = m_bits / block_bits;
+        size_t block = (size_t)(h1 % n_blocks);
+
+        for (size_t w = 0; w < 8; ++w) masks[w] = 0;
+        for (size_t i = 0; i < k_hashes; ++i) {
+            uint32_t h = (uint32_t)(h2 >> (i & 16 ? 32 : 0));
+            size_t offset = (size_t)((h * BLOOM_SALT[i & 15]) >> block_shift);
+            masks[offset >> 6] |= 1ULL << (offset & 63);
+        }
+        return block * block_bits / 64;
+    }
+
+    bool insert(uint64_t key) override {
+        uint64_t masks[8];
+        size_t base = key_masks(key, masks);
+        size_t block_words = (block_bits + 63) / 64;
+        for (size_t w = 0; w < block_words; ++w) {
+            if (!masks[w]) continue;
+            atomic<uint64_t> &word = bits[base + w];
+            if ((word.load(memory_order_relaxed) & masks[w]) != masks[w]) {
+                word.fetch_or(masks[w], memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+
+    bool contains(uint64_t key) const override {
+        uint64_t masks[8];
+        size_t base = key_masks(key, masks);
+        size_t block_words = (block_bits + 63) / 64;
+        for (size_t w = 0; w < block_words; ++w) {
+            uint64_t v = bits[base + w].load(memory_order_relaxed);
+            if ((v & masks[w]) != masks[w]) return false;
+        }
+        return true;
+    }
+
+    bool erase(uint64_t) override {
+        return false; // no deletes
+    }
+
+    size_t bytes_used() const override {
+        return n_words * sizeof(uint64_t);
+    }
+};
+
+// ====================== Split-Block Bloom Filter ======================
+//
+// Parquet/Impala layout: a key hashes to one bucket of W 32-bit lanes
+// (W=8 -> 32 bytes, W=16 -> 64 bytes) and sets exactly one bit per lane,
+// chosen by multiplying the low hash word with a per-lane odd salt. A lookup
+// is one bucket load plus a lane-parallel mask test.
+
+template<size_t W>
+struct SplitBlockBloomFilter final : public ApproxFilter {
+    static_assert(W == 8 || W == 16, "bucket must be 8 or 16 lanes");
+
+    size_t num_buckets;
+    uint64_t seed;
+    AlignedArray<uint32_t> buckets;  // num_buckets * W lanes
+
+    static constexpr const uint32_t* SALT = BLOOM_SALT;
+
+    SplitBlockBloomFilter(size_t n, double target_fpr, uint64_t seed_ = 9)
+        : seed(seed_)
+    {
+        // the classic formula treats the filter as one flat bit array and
+        // lands well over target; size for the per-bucket load instead
+        double lo = 1e-3, hi = 4096.0;
+        for (int it = 0; it < 60; ++it) {
+            double mid = sqrt(lo * hi);
+            (expected_fpr(mid) > target_fpr ? hi : lo) = mid;
+        }
+        num_buckets = max<size_t>(1, (size_t)ceil((double)n / lo));
+        buckets.assign(num_buckets * W, W * sizeof(uint32_t));
+    }
+
+    // FPR at an average of `load` keys per bucket: bucket loads are
+    // Poisson, and a bucket holding j keys answers a stranger yes when all
+    // W of its lane bits are set, (1 - (31/32)^j)^W.
+    static double expected_fpr(double load) {
+        double fpr = 0.0;
+        size_t last = (size_t)(load + 12.0 * sqrt(load) + 16.0);
+        for (size_t j = 1; j <= last; ++j) {
+            double pmf = exp(-load + (double)j * log(load) - lgamma(j + 1.0));
+            fpr += pmf * pow(1.0 - pow(31.0 / 32.0, (double)j), (double)W);
+        }
+        return fpr;
+    }
+
+    // ---- persistence ----
+    // params: num_buckets, W; arrays: buckets
+    explicit SplitBlockBloomFilter(const FilterImage &img)
+        : num_buckets(img.h.params[0]), seed(img.h.seed[0])
+    {
+        img.bind(buckets, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        return p[0] != 0 && p[1] == W &&
+               img.is(FilterType::BLOOM_SPLIT, {p[0] * W * sizeof(uint32_t)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::BLOOM_SPLIT);
+        h.seed[0] = seed;
+        h.params[0] = num_buckets;
+        h.params[1] = W;
+        return write_filter_file(path, h, {
+            {buckets.data(), buckets.size() * sizeof(uint32_t)}
+        });
+    }
+
+    inline size_t bucket_index(uint64_t h) const {
+        return (size_t)(((h >> 32) * (uint64_t)num_buckets) >> 32);
+    }
+    inline const uint32_t* bucket_of(uint64_t h) const {
+        return &buckets[bucket_index(h) * W];
+    }
+
+    // 64-byte buckets are checked as two 256-bit halves
+    static inline bool bucket_check(const uint32_t* b, uint32_t key32) {
+#if defined(__AVX2__)
+        {
+            __m256i k = _mm256_set1_epi32((int)key32);
+            bool ok = true;
+            for (size_t h = 0; h < W; h += 8) {
+                __m256i s = _mm256_load_si256((const __m256i*)(SALT + h));
+                __m256i sh = _mm256_srli_epi32(_mm256_mullo_epi32(k, s), 27);
+                __m256i m = _mm256_sllv_epi32(_mm256_set1_epi32(1), sh);
+                __m256i v = _mm256_load_si256((const __m256i*)(b + h));
+                ok &= (bool)_mm256_testc_si256(v, m);
+            }
+            return ok;
+        }
+#endif
+        uint32_t miss = 0;
+        for (size_t i = 0; i < W; ++i) {
+            uint32_t bit = 1u << ((key32 * SALT[i]) >> 27);
+            miss |= bit & ~b[i];
+        }
+        return miss == 0;
+    }
+
+    bool insert(uint64_t key) override {
+        uint64_t h = hash64(key, seed);
+        uint32_t* b = &buckets[bucket_index(h) * W];
+        uint32_t key32 = (uint32_t)h;
+        for (size_t i = 0; i < W; ++i) {
+            b[i] |= 1u << ((key32 * SALT[i]) >> 27);
+        }
+        return true;
+    }
+
+    bool contains(uint64_t key) const override {
+        uint64_t h = hash64(key, seed);
+        return bucket_check(bucket_of(h), (uint32_t)h);
+    }
+
+    void contains_batch(const uint64_t* keys, size_t n,
+                        uint8_t* out) const override {
+        constexpr size_t BATCH = 8;
+        uint64_t hs[BATCH];
+        for (size_t i = 0; i < n; i += BATCH) {
+            size_t g = min(BATCH, n - i);
+            for (size_t j = 0; j < g; ++j) {
+                hs[j] = hash64(keys[i + j], seed);
+                __builtin_prefetch(bucket_of(hs[j]));
+            }
+            for (size_t j = 0; j < g; ++j) {
+                out[i + j] = bucket_check(bucket_of(hs[j]),
+                                          (uint32_t)hs[j]) ? 1 : 0;
+            }
+        }
+    }
+
+    bool erase(uint64_t) override {
+        return false; // no deletes
+    }
+
+    size_t bytes_used() const override {
+        return num_buckets * W * sizeof(uint32_t);
+    }
+};
+
+// ====================== Scalable Bloom Filter ======================
+//
+// Almeida et al. scalable Bloom filter for an unknown number of keys: a
+// chain of stages, each a SplitBlockBloomFilter<8> (its FPR follows the
+// sizing formula, which the chain's budget depends on). Stage i is sized for
+// initial_n * GROWTH^i keys at fpr0 * TIGHTEN^i with fpr0 = target *
+// (1 - TIGHTEN), so the compound FPR stays below target however long the
+// chain gets. Only the newest stage takes inserts; adding a stage is one
+// lazily-zeroed allocation, so no insert ever pays for rehashing.
+
+struct ScalableBloomFilter final : public ApproxFilter {
+    static constexpr double GROWTH = 2.0;
+    static constexpr double TIGHTEN = 0.8;
+
+    using Stage = SplitBlockBloomFilter<8>;
+
+    double target_fpr;
+    size_t initial_n;
+    vector<unique_ptr<Stage>> stages;
+    size_t stage_capacity;   // keys the newest stage was sized for
+    size_t stage_items;      // keys added to the newest stage
+    size_t n_items;
+
+    explicit ScalableBloomFilter(double target_fpr_, size_t initial_n_ = 1024)
+        : target_fpr(target_fpr_), initial_n(max<size_t>(1, initial_n_)),
+          stage_capacity(0), stage_items(0), n_items(0)
+    {
+        add_stage();
+    }
+
+    void add_stage() {
+        size_t i = stages.size();
+        stage_capacity = (size_t)(initial_n * pow(GROWTH, (double)i));
+        double fpr = target_fpr * (1.0 - TIGHTEN) * pow(TIGHTEN, (double)i);
+        stages.push_back(make_unique<Stage>(stage_capacity, fpr, 9 + i));
+        stage_items = 0;
+    }
+
+    bool insert(uint64_t key) override {
+        // re-inserts must not count toward a stage's capacity
+        if (contains(key)) return true;
+        if (stage_items >= stage_capacity) add_stage();
+        stages.back()->insert(key);
+        stage_items++;
+        n_items++;
+        return true;
+    }
+
+    bool contains(uint64_t key) const override {
+        for (size_t i = stages.size(); i-- > 0; ) {
+            if (stages[i]->contains(key)) return true;
+        }
+        return false;
+    }
+
+    bool erase(uint64_t) override {
+        return false; // no deletes
+    }
+
+    size_t bytes_used() const override {
+        size_t bytes = 0;
+        for (const auto &s : stages) bytes += s->bytes_used();
+        return bytes;
+    }
+
+    // Keys the chain can take before its next stage is added.
+    size_t capacity() const {
+        return n_items - stage_items + stage_capacity;
+    }
+};
+
+// ====================== Cuckoo Filter ======================
+//
+// Buckets are B consecutive W-bit slots in one 64-byte-aligned array. At
+// W=16 (the default) and W=8 a bucket never straddles a cache line and B=4
+// and B=8 buckets are matched with a single SSE compare. Other widths are
+// bit-packed (see FingerprintArray) and a bucket is matched as one 64-bit
+// word with a SWAR zero-lane test, so B * W must fit in 56 bits. Runtime
+// fp_bits is still derived from the target FPR but capped at W.
+//
+// An insert that finds both buckets full searches breadth-first (up to
+// MAX_BFS_NODES buckets) for the shortest chain of moves that ends in a
+// free slot and applies it from the free end back, so nothing moves unless
+// a path exists. Only when none is in reach does it fall back to the
+// classic random walk of up to max_kicks evictions. Both draw from a
+// per-filter xorshift, so inserts are reproducible for a given seed.
+//
+// Adaptive mode (after Mitzenmacher et al.'s adaptive cuckoo filter): the
+// top two bits of a slot select which 16-bit slice of the key hash its
+// fingerprint was taken from. report_false_positive(key) moves every slot
+// that matched the negative key to the next selector, so that key stops
+// matching there. Re-fingerprinting needs the stored key, which the
+// filter keeps beside the table as a stand-in for the remote store being
+// guarded; it is not counted in bytes_used(). Cuckoo moves take alternate
+// buckets from the selector-0 fingerprint of the stored key, so they are
+// unaffected by adaptation. A lookup encodes its four selector
+// fingerprints once and makes one pass over each bucket, comparing every
+// slot with the encoding for that slot's selector; hashing, bucket loads
+// and the prefetched batch path are those of the plain filter.
+
+// saved in cuckoo images (params[3]): never renumber
+enum class CuckooEviction : uint32_t { RANDOM_WALK = 0, BFS = 1 };
+
+template<size_t B = 4, unsigned W = 16>
+struct BasicCuckooFilter final : public ApproxFilter {
+    static_assert(B == 2 || B == 4 || B == 8, "bucket size must be 2, 4 or 8");
+    static_assert(!FingerprintArray<W>::PACKED || B * W <= 56,
+                  "a packed bucket must fit one 64-bit window");
+    static constexpr size_t bucket_size = B;
+    static constexpr unsigned fp_width = W;
+    static constexpr size_t MAX_BFS_NODES = 2048;  // depth 5 at B=4
+    static constexpr unsigned SELECTORS = 4;        // adaptive mode
+    static constexpr unsigned SEL_SHIFT = W - 2;
+
+    struct PathNode {
+        size_t bucket;
+        int parent;   // index into bfs_nodes, -1 for a root
+        int slot;     // slot of the parent bucket whose fp moves here
+    };
+
+    size_t bucket_count;
+    size_t fp_bits;
+    uint16_t fp_mask;
+    FingerprintArray<W> table;  // bucket_count * B slots, 0 means empty
+    uint64_t seed_main;
+    size_t max_kicks;
+    size_t failures;
+    size_t stash_size;
+    vector<uint16_t> stash;
+    CuckooEviction eviction;
+    Xorshift64 rng;
+    vector<PathNode> bfs_nodes;   // search scratch, reused across inserts
+    vector<int> bfs_path;
+    bool adaptive;
+    vector<uint64_t> slot_keys;   // adaptive: key held by each slot
+    vector<uint64_t> stash_keys;
+
+    // dynamic stats
+    size_t insert_calls;
+    size_t total_kicks;
+    size_t stash_inserts;
+    size_t walk_fallbacks;   // BFS found no path in reach
+    size_t fp_reports;
+    size_t adaptations;      // slots moved to another selector
+
+    BasicCuckooFilter(size_t n, double target_fpr,
+                      size_t fp_bits_hint = 8,
+                      uint64_t seed = 3,
+                      size_t max_kicks_ = 500,
+                      CuckooEviction eviction_ = CuckooEviction::BFS,
+                      bool adaptive_ = false)
+        : seed_main(seed),
+          max_kicks(max_kicks_),
+          failures(0),
+          stash_size(0),
+          eviction(eviction_),
+          rng(hash64(seed, 0x6b1c4e5a9d2f3087ULL)),
+          adaptive(adaptive_),
+          insert_calls(0),
+          total_kicks(0),
+          stash_inserts(0),
+          walk_fallbacks(0),
+          fp_reports(0),
+          adaptations(0)
+    {
+        int f_from_p = (int)ceil(-log2(target_fpr * B));
+        int f = (int)fp_bits_hint;
+        if (f_from_p > 0) f = max(f, f_from_p);
+        // adaptive slots give their top two bits to the selector
+        f = max(4, min((int)(adaptive ? SEL_SHIFT : W), f));
+        fp_bits = (size_t)f;
+        fp_mask = (uint16_t)((1u << fp_bits) - 1u);
+
+        double lf = 0.9;
+        double buckets_f = (double)n / (lf * (double)B);
         bucket_count = 1;
         while (bucket_count < (size_t)buckets_f) bucket_count <<= 1;
-        table.assign(bucket_count, Bucket(bucket_size));
+        table.assign(bucket_count * B);
+        if (adaptive) slot_keys.assign(bucket_count * B, 0);
     }
 
-    inline uint16_t fingerprint(uint64_t key) const {
-        uint64_t h = hash64(key, seed_main);
-        uint16_t fp = (uint16_t)(h & fp_mask);
+    // ---- persistence ----
+    // params: bucket_count, B, max_kicks, eviction, W (0 = 16);
+    // arrays: table, stash
+    explicit BasicCuckooFilter(const FilterImage &img)
+        : bucket_count(img.h.params[0]),
+          fp_bits(img.h.fp_bits),
+          fp_mask((uint16_t)((1u << img.h.fp_bits) - 1u)),
+          seed_main(img.h.seed[0]),
+          max_kicks(img.h.params[2]),
+          failures(0),
+          eviction((CuckooEviction)img.h.params[3]),
+          rng(hash64(img.h.seed[0], 0x6b1c4e5a9d2f3087ULL)),
+          adaptive(false),
+          insert_calls(0),
+          total_kicks(0),
+          stash_inserts(0),
+          walk_fallbacks(0),
+          fp_reports(0),
+          adaptations(0)
+    {
+        img.bind(table.data, 0);
+        table.n = bucket_count * B;
+        AlignedArray<uint16_t> st;
+        img.bind(st, 1);
+        stash.assign(st.begin(), st.end());
+        stash_size = stash.size();
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        if (p[0] == 0 || (p[0] & (p[0] - 1)) || p[1] != B || p[3] > 1 ||
+            p[4] != W ||
+            img.h.fp_bits < 4 || img.h.fp_bits > W || img.h.n_arrays != 2) {
+            return false;
+        }
+        size_t table_bytes = FingerprintArray<W>::words_for(p[0] * B) *
+                             sizeof(typename FingerprintArray<W>::word_t);
+        return img.is(FilterType::CUCKOO,
+                      {table_bytes, img.h.arrays[1].bytes});
+    }
+
+    // Adaptive filters aren't saved: their selectors are only meaningful
+    // next to the stored keys, which images don't carry.
+    bool save(const string &path) const {
+        if (adaptive) return false;
+        FilterFileHeader h = filter_header(FilterType::CUCKOO);
+        h.seed[0] = seed_main;
+        h.fp_bits = (uint32_t)fp_bits;
+        h.params[0] = bucket_count;
+        h.params[1] = B;
+        h.params[2] = max_kicks;
+        h.params[3] = (uint64_t)eviction;
+        h.params[4] = W;
+        return write_filter_file(path, h, {
+            {table.data.data(), table.bytes()},
+            {stash.data(), stash.size() * sizeof(uint16_t)}
+        });
+    }
+
+    // Selector sel takes the fingerprint from bits [16 sel, 16 sel + fp_bits)
+    // of the key hash; sel 0 is the plain fingerprint.
+    inline uint16_t fp_slice(uint64_t h, unsigned sel) const {
+        uint16_t fp = (uint16_t)((h >> (16 * sel)) & fp_mask);
         if (fp == 0) fp = 1;
         return fp;
     }
 
+    inline uint16_t fingerprint(uint64_t key, unsigned sel = 0) const {
+        return fp_slice(hash64(key, seed_main), sel);
+    }
+
     inline size_t index_hash(uint64_t key) const {
         uint64_t h = hash64(key, seed_main ^ 0x12345678abcdefULL);
         return (size_t)(h & (bucket_count - 1));
@@ -216,12 +1647,153 @@ struct CuckooFilter : public ApproxFilter {
         return (idx ^ (size_t)(h & (bucket_count - 1)));
     }
 
-    bool bucket_insert(Bucket &b, uint16_t fp) {
-        for (auto &slot : b.slots) {
-            if (slot == 0) {
-                slot = fp;
+    inline uint16_t slot(size_t i, size_t s) const { return table.get(i * B + s); }
+    inline void set_slot(size_t i, size_t s, uint16_t v) { table.set(i * B + s, v); }
+    inline const void* bucket_addr(size_t i) const { return table.addr(i * B); }
+
+    // the low / high bit of each W-bit lane of a packed bucket
+    static constexpr uint64_t LANE_ONES =
+        B * W < 64 ? ((1ULL << (B * W)) - 1) / ((1ULL << W) - 1) : 0;
+    static constexpr uint64_t LANE_HIGH = LANE_ONES << (W - 1);
+
+    // Slot index of the first occurrence of fp in bucket i, or -1.
+    inline int bucket_find(size_t i, uint16_t fp) const {
+        if constexpr (FingerprintArray<W>::PACKED) {
+            // the lowest flagged lane is exact; borrows only corrupt lanes
+            // above it
+            uint64_t x = table.window(i * B, B) ^ (LANE_ONES * fp);
+            uint64_t z = (x - LANE_ONES) & ~x & LANE_HIGH;
+            return z ? (int)(__builtin_ctzll(z) / W) : -1;
+        } else {
+            const auto* b = &table.data[i * B];
+#if defined(__SSE2__)
+            if constexpr (W == 16 && (B == 4 || B == 8)) {
+                __m128i v = (B == 8) ? _mm_load_si128((const __m128i*)b)
+                                     : _mm_loadl_epi64((const __m128i*)b);
+                __m128i eq = _mm_cmpeq_epi16(v, _mm_set1_epi16((short)fp));
+                unsigned m = (unsigned)_mm_movemask_epi8(eq);
+                if (B == 4) m &= 0xffu;
+                return m ? (int)(__builtin_ctz(m) >> 1) : -1;
+            }
+            if constexpr (W == 8 && (B == 4 || B == 8)) {
+                uint64_t w = table.window(i * B, B);
+                __m128i v = _mm_cvtsi64_si128((long long)w);
+                __m128i eq = _mm_cmpeq_epi8(v, _mm_set1_epi8((char)fp));
+                unsigned m = (unsigned)_mm_movemask_epi8(eq) & ((1u << B) - 1);
+                return m ? __builtin_ctz(m) : -1;
+            }
+#endif
+            for (size_t s = 0; s < B; ++s) if (b[s] == fp) return (int)s;
+            return -1;
+        }
+    }
+
+    // Whether bucket i holds a slot equal to v[its selector]. A slot can
+    // only equal v[s] if its top bits are s, so OR-ing the SELECTORS
+    // compares over one load of the bucket is that single pass.
+    inline bool bucket_has_any(size_t i, const uint16_t* v) const {
+        if constexpr (FingerprintArray<W>::PACKED) {
+            uint64_t w = table.window(i * B, B);
+            uint64_t z = 0;
+            for (unsigned s = 0; s < SELECTORS; ++s) {
+                uint64_t x = w ^ (LANE_ONES * v[s]);
+                z |= (x - LANE_ONES) & ~x;
+            }
+            return (z & LANE_HIGH) != 0;
+        } else {
+            const auto* b = &table.data[i * B];
+#if defined(__SSE2__)
+            if constexpr (W == 16 && (B == 4 || B == 8)) {
+                __m128i x = (B == 8) ? _mm_load_si128((const __m128i*)b)
+                                     : _mm_loadl_epi64((const __m128i*)b);
+                __m128i eq = _mm_setzero_si128();
+                for (unsigned s = 0; s < SELECTORS; ++s) {
+                    eq = _mm_or_si128(eq, _mm_cmpeq_epi16(
+                        x, _mm_set1_epi16((short)v[s])));
+                }
+                unsigned m = (unsigned)_mm_movemask_epi8(eq);
+                if (B == 4) m &= 0xffu;
+                return m != 0;
+            }
+            if constexpr (W == 8 && (B == 4 || B == 8)) {
+                __m128i x = _mm_cvtsi64_si128((long long)table.window(i * B, B));
+                __m128i eq = _mm_setzero_si128();
+                for (unsigned s = 0; s < SELECTORS; ++s) {
+                    eq = _mm_or_si128(eq, _mm_cmpeq_epi8(
+                        x, _mm_set1_epi8((char)v[s])));
+                }
+                return ((unsigned)_mm_movemask_epi8(eq) & ((1u << B) - 1)) != 0;
+            }
+#endif
+            for (size_t s = 0; s < B; ++s) {
+                if (b[s] == v[b[s] >> SEL_SHIFT]) return true;
+            }
+            return false;
+        }
+    }
+
+#if defined(__SSSE3__)
+    // Same test for 16-bit slots with the encodings in lanes 0..3 of vv:
+    // each slot's selector picks its lane of vv through a byte shuffle, so
+    // a bucket costs one compare however many selectors there are.
+    inline bool bucket_has_any(size_t i, __m128i vv) const {
+        const auto* b = &table.data[i * B];
+        __m128i x = (B == 8) ? _mm_load_si128((const __m128i*)b)
+                             : _mm_loadl_epi64((const __m128i*)b);
+        __m128i sel = _mm_srli_epi16(x, SEL_SHIFT);
+        __m128i idx = _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi16(sel, 1), _mm_slli_epi16(sel, 9)),
+            _mm_set1_epi16(0x0100));
+        __m128i eq = _mm_cmpeq_epi16(x, _mm_shuffle_epi8(vv, idx));
+        unsigned m = (unsigned)_mm_movemask_epi8(eq);
+        if (B == 4) m &= 0xffu;
+        return m != 0;
+    }
+#endif
+
+    inline uint64_t key_at(size_t i, size_t s) const {
+        return adaptive ? slot_keys[i * B + s] : 0;
+    }
+
+    // fingerprint that picks the slot's alternate bucket
+    inline uint16_t home_fp(size_t i, size_t s) const {
+        return adaptive ? fingerprint(slot_keys[i * B + s]) : slot(i, s);
+    }
+
+    // Puts v into a free slot of bucket i (with its key, if adaptive).
+    bool bucket_insert(size_t i, uint16_t v, uint64_t key) {
+        int s = bucket_find(i, 0);
+        if (s < 0) return false;
+        set_slot(i, (size_t)s, v);
+        if (adaptive) slot_keys[i * B + s] = key;
+        return true;
+    }
+
+    // BFS from {i1, i2} for the nearest bucket with a free slot; fills
+    // bfs_path root-first. A chain never revisits one of its own buckets,
+    // so every hop still moves the fingerprint the search saw.
+    bool find_path(size_t i1, size_t i2) {
+        bfs_nodes.clear();
+        bfs_nodes.push_back({i1, -1, -1});
+        if (i2 != i1) bfs_nodes.push_back({i2, -1, -1});
+        for (size_t idx = 0; idx < bfs_nodes.size(); ++idx) {
+            size_t cur = bfs_nodes[idx].bucket;
+            if (bucket_find(cur, 0) >= 0) {
+                bfs_path.clear();
+                for (int k = (int)idx; k >= 0; k = bfs_nodes[k].parent) {
+                    bfs_path.push_back(k);
+                }
+                reverse(bfs_path.begin(), bfs_path.end());
                 return true;
             }
+            for (int s = 0; s < (int)B && bfs_nodes.size() < MAX_BFS_NODES; ++s) {
+                size_t next = alt_index(cur, home_fp(cur, (size_t)s));
+                bool cycle = false;
+                for (int k = (int)idx; k >= 0 && !cycle; k = bfs_nodes[k].parent) {
+                    cycle = bfs_nodes[k].bucket == next;
+                }
+                if (!cycle) bfs_nodes.push_back({next, (int)idx, s});
+            }
         }
         return false;
     }
@@ -233,21 +1805,46 @@ struct CuckooFilter : public ApproxFilter {
         size_t i1 = index_hash(key);
         size_t i2 = alt_index(i1, fp);
 
-        if (bucket_insert(table[i1], fp)) return true;
-        if (bucket_insert(table[i2], fp)) return true;
+        if (bucket_insert(i1, fp, key)) return true;
+        if (bucket_insert(i2, fp, key)) return true;
+
+        if (eviction == CuckooEviction::BFS) {
+            if (bfs_nodes.capacity() == 0) bfs_nodes.reserve(MAX_BFS_NODES);
+            if (find_path(i1, i2)) {
+                // from the free end back: each hop empties the slot the
+                // next one (towards the root) fills
+                for (size_t k = bfs_path.size() - 1; k >= 1; --k) {
+                    const PathNode &to = bfs_nodes[bfs_path[k]];
+                    size_t from = bfs_nodes[bfs_path[k - 1]].bucket;
+                    bucket_insert(to.bucket, slot(from, (size_t)to.slot),
+                                  key_at(from, (size_t)to.slot));
+                    set_slot(from, (size_t)to.slot, 0);
+                    total_kicks++;
+                }
+                bucket_insert(bfs_nodes[bfs_path[0]].bucket, fp, key);
+                return true;
+            }
+            walk_fallbacks++;
+        }
 
-        size_t i = (rand() & 1) ? i1 : i2;
+        size_t i = (rng.next() & 1) ? i1 : i2;
         uint16_t cur_fp = fp;
+        uint64_t cur_key = key;
         for (size_t kick = 0; kick < max_kicks; ++kick) {
-            Bucket &b = table[i];
-            size_t victim = (size_t)(rand() % bucket_size);
-            swap(cur_fp, b.slots[victim]); // evict
+            size_t victim = (size_t)(rng.next() % B);
+            uint16_t evicted = slot(i, victim);
+            uint64_t evicted_key = key_at(i, victim);
+            set_slot(i, victim, cur_fp); // evict
+            if (adaptive) slot_keys[i * B + victim] = cur_key;
+            cur_fp = evicted;
+            cur_key = evicted_key;
             total_kicks++;
-            i = alt_index(i, cur_fp);
-            if (bucket_insert(table[i], cur_fp)) return true;
+            i = alt_index(i, adaptive ? fingerprint(cur_key) : cur_fp);
+            if (bucket_insert(i, cur_fp, cur_key)) return true;
         }
         if (stash.size() < 64) {
             stash.push_back(cur_fp);
+            if (adaptive) stash_keys.push_back(cur_key);
             stash_size++;
             stash_inserts++;
             return true;
@@ -258,27 +1855,155 @@ struct CuckooFilter : public ApproxFilter {
     }
 
     bool contains(uint64_t key) const override {
-        uint16_t fp = fingerprint(key);
+        uint64_t h = hash64(key, seed_main);
+        uint16_t fp = fp_slice(h, 0);
         size_t i1 = index_hash(key);
         size_t i2 = alt_index(i1, fp);
 
-        for (auto v : table[i1].slots) if (v == fp) return true;
-        for (auto v : table[i2].slots) if (v == fp) return true;
+        if (adaptive) return lookup_adaptive(i1, i2, h);
+        return lookup(i1, i2, fp);
+    }
+
+    inline uint16_t encode(uint16_t fp, unsigned sel) const {
+        return (uint16_t)(fp | (sel << SEL_SHIFT));
+    }
+
+    // Whether bucket i1 or i2 holds one of h's selector encodings; the
+    // encodings are built once for both buckets.
+    inline bool buckets_match(size_t i1, size_t i2, uint64_t h) const {
+#if defined(__SSSE3__)
+        if constexpr (!FingerprintArray<W>::PACKED && W == 16 &&
+                      (B == 4 || B == 8)) {
+            // lane s: slice s of h, masked, 0 -> 1, tagged with s
+            __m128i vv = _mm_and_si128(_mm_cvtsi64_si128((long long)h),
+                                       _mm_set1_epi16((short)fp_mask));
+            vv = _mm_sub_epi16(vv, _mm_cmpeq_epi16(vv, _mm_setzero_si128()));
+            vv = _mm_or_si128(vv, _mm_setr_epi16(
+                0, (short)(1u << SEL_SHIFT), (short)(2u << SEL_SHIFT),
+                (short)(3u << SEL_SHIFT), 0, 0, 0, 0));
+            return bucket_has_any(i1, vv) || bucket_has_any(i2, vv);
+        }
+#endif
+        uint16_t v[SELECTORS];
+        for (unsigned sel = 0; sel < SELECTORS; ++sel) {
+            v[sel] = encode(fp_slice(h, sel), sel);
+        }
+        return bucket_has_any(i1, v) || bucket_has_any(i2, v);
+    }
+
+    bool lookup_adaptive(size_t i1, size_t i2, uint64_t h) const {
+        if (buckets_match(i1, i2, h)) return true;
+        for (auto e : stash) {
+            unsigned sel = e >> SEL_SHIFT;
+            if (e == encode(fp_slice(h, sel), sel)) return true;
+        }
+        return false;
+    }
+
+    // `key` tested positive but is not in the set. Every slot of its two
+    // buckets (and the stash) that matched it moves to the next selector
+    // and is re-fingerprinted from the key it holds, so the filter stays
+    // free of false negatives. Returns the number of slots changed.
+    size_t report_false_positive(uint64_t key) {
+        if (!adaptive) return 0;
+        fp_reports++;
+        uint64_t h = hash64(key, seed_main);
+        size_t i1 = index_hash(key);
+        size_t i2 = alt_index(i1, fp_slice(h, 0));
+        size_t changed = 0;
+        auto adapt = [&](uint16_t &v, uint64_t held) {
+            unsigned sel = v >> SEL_SHIFT;
+            if (v == 0 || held == key || v != encode(fp_slice(h, sel), sel)) {
+                return;
+            }
+            sel = (sel + 1) % SELECTORS;
+            v = encode(fingerprint(held, sel), sel);
+            changed++;
+        };
+        for (size_t i : {i1, i2}) {
+            for (size_t s = 0; s < B; ++s) {
+                uint16_t v = slot(i, s);
+                adapt(v, slot_keys[i * B + s]);
+                set_slot(i, s, v);
+            }
+            if (i2 == i1) break;
+        }
+        for (size_t j = 0; j < stash.size(); ++j) adapt(stash[j], stash_keys[j]);
+        adaptations += changed;
+        return changed;
+    }
+
+    inline bool lookup(size_t i1, size_t i2, uint16_t fp) const {
+        if (bucket_find(i1, fp) >= 0) return true;
+        if (bucket_find(i2, fp) >= 0) return true;
         for (auto v : stash) if (v == fp) return true;
         return false;
     }
 
+    // ---- batched lookup ----
+    // Two passes over groups of up to PIPE keys: hash everything and
+    // prefetch both candidate buckets, then probe. The caller's batch size
+    // sets the group size, so the number of misses in flight is tunable.
+    static constexpr size_t PIPE = 64;
+
+    void contains_batch(const uint64_t* keys, size_t n,
+                        uint8_t* out) const override {
+        size_t i1s[PIPE], i2s[PIPE];
+        uint64_t hs[PIPE];
+        uint16_t fps[PIPE];
+
+        // bucket addresses never depend on selectors, so adaptive lookups
+        // prefetch the same way
+        for (size_t i = 0; i < n; i += PIPE) {
+            size_t g = min(PIPE, n - i);
+            for (size_t j = 0; j < g; ++j) {
+                hs[j] = hash64(keys[i + j], seed_main);
+                fps[j] = fp_slice(hs[j], 0);
+                i1s[j] = index_hash(keys[i + j]);
+                i2s[j] = alt_index(i1s[j], fps[j]);
+                __builtin_prefetch(bucket_addr(i1s[j]));
+                __builtin_prefetch(bucket_addr(i2s[j]));
+            }
+            for (size_t j = 0; j < g; ++j) {
+                bool hit = adaptive ? lookup_adaptive(i1s[j], i2s[j], hs[j])
+                                    : lookup(i1s[j], i2s[j], fps[j]);
+                out[i + j] = hit ? 1 : 0;
+            }
+        }
+    }
+
     bool erase(uint64_t key) override {
         uint16_t fp = fingerprint(key);
         size_t i1 = index_hash(key);
         size_t i2 = alt_index(i1, fp);
 
-        for (auto &v : table[i1].slots) {
-            if (v == fp) { v = 0; return true; }
-        }
-        for (auto &v : table[i2].slots) {
-            if (v == fp) { v = 0; return true; }
+        // adaptive slots are matched by the exact key they hold
+        if (adaptive) {
+            for (size_t i : {i1, i2}) {
+                for (size_t s = 0; s < B; ++s) {
+                    if (slot(i, s) && slot_keys[i * B + s] == key) {
+                        set_slot(i, s, 0);
+                        return true;
+                    }
+                }
+            }
+            for (size_t j = 0; j < stash.size(); ++j) {
+                if (stash_keys[j] == key) {
+                    stash[j] = stash.back();
+                    stash.pop_back();
+                    stash_keys[j] = stash_keys.back();
+                    stash_keys.pop_back();
+                    stash_size--;
+                    return true;
+                }
+            }
+            return false;
         }
+
+        int s = bucket_find(i1, fp);
+        if (s >= 0) { set_slot(i1, (size_t)s, 0); return true; }
+        s = bucket_find(i2, fp);
+        if (s >= 0) { set_slot(i2, (size_t)s, 0); return true; }
         for (auto &v : stash) {
             if (v == fp) {
                 v = stash.back();
@@ -292,7 +2017,7 @@ struct CuckooFilter : public ApproxFilter {
 
     size_t bytes_used() const override {
         size_t bytes = 0;
-        bytes += bucket_count * bucket_size * sizeof(uint16_t);
+        bytes += table.bytes();
         bytes += stash.capacity() * sizeof(uint16_t);
         return bytes;
     }
@@ -310,44 +2035,556 @@ struct CuckooFilter : public ApproxFilter {
     }
 };
 
-// ====================== Quotient Filter (simple, safe) ======================
-
-struct QuotientFilter : public ApproxFilter {
-    struct Slot {
-        uint16_t rem;   // remainder (fingerprint)
-        uint8_t  state; // 0 = empty, 1 = used, 2 = tombstone
-    } __attribute__((packed));
-
-    size_t table_size;   // power of two
-    size_t qbits;        // log2(table_size)
-    size_t rbits;        // remainder bits
-    uint64_t seed;
-    vector<Slot> table;
-
-    // stats
-    size_t insert_calls;
-    uint64_t total_probe_len_insert;
+using CuckooFilter = BasicCuckooFilter<4>;
+
+// ====================== Concurrent Cuckoo Filter ======================
+//
+// Thread-safe cuckoo filter with the same hashing as CuckooFilter. A bucket
+// is four 16-bit slots packed into one atomic 64-bit word. Buckets map onto
+// a fixed set of stripes whose version counter is both the writer lock
+// (odd = held) and a seqlock for readers: contains() reads both buckets
+// without locking and retries if either stripe moved underneath it.
+//
+// Inserts that find both buckets full search for a displacement path by BFS
+// without holding any lock, then execute it from the free end backwards,
+// one hop at a time under the two stripes involved. Every hop rechecks that
+// the slot still holds a fingerprint whose alternate bucket is the next hop;
+// a stale path is simply searched again.
+
+struct ConcurrentCuckooFilter final : public ApproxFilter {
+    static constexpr size_t B = 4;
+    static constexpr size_t STRIPES = 4096;
+    static constexpr int MAX_BFS_DEPTH = 5;
+    static constexpr int MAX_PATH_RETRIES = 8;
+    static constexpr uint64_t LANE_ONES = 0x0001000100010001ULL;
+    static constexpr uint64_t LANE_HIGH = 0x8000800080008000ULL;
 
-    QuotientFilter(size_t n,
-                   double target_fpr,
-                   size_t rbits_hint = 8,
-                   uint64_t seed_ = 5)
-        : seed(seed_), insert_calls(0), total_probe_len_insert(0)
+    size_t bucket_count;
+    size_t fp_bits;
+    uint16_t fp_mask;
+    uint64_t seed_main;
+    unique_ptr<atomic<uint64_t>[]> table;     // one word per bucket
+    unique_ptr<atomic<uint64_t>[]> versions;  // per stripe
+
+    // stats (relaxed; read after the workers join)
+    atomic<size_t> insert_calls;
+    atomic<size_t> failures;
+    atomic<size_t> total_kicks;
+    atomic<size_t> path_retries;
+
+    ConcurrentCuckooFilter(size_t n, double target_fpr,
+                           size_t fp_bits_hint = 8,
+                           uint64_t seed = 3)
+        : seed_main(seed), insert_calls(0), failures(0),
+          total_kicks(0), path_retries(0)
     {
-        int r_from_p = (int)ceil(-log2(target_fpr));
-        int r = (int)rbits_hint;
-        if (r_from_p > 0) r = max(r, r_from_p);
-        r = max(4, min(16, r));  // clamp to 4..16 bits
-        rbits = (size_t)r;
-
-        double load = 0.8;
-        double needed = (double)n / load;
-        size_t sz = 1;
-        while (sz < (size_t)needed) sz <<= 1;
-        table_size = sz;
-        qbits = (size_t)round(log2((double)table_size));
+        int f_from_p = (int)ceil(-log2(target_fpr * B));
+        int f = (int)fp_bits_hint;
+        if (f_from_p > 0) f = max(f, f_from_p);
+        f = max(4, min(16, f));
+        fp_bits = (size_t)f;
+        fp_mask = (uint16_t)((1u << fp_bits) - 1u);
 
-        table.assign(table_size, Slot{0, 0});
+        double lf = 0.9;
+        double buckets_f = (double)n / (lf * (double)B);
+        bucket_count = 1;
+        while (bucket_count < (size_t)buckets_f) bucket_count <<= 1;
+        table.reset(new atomic<uint64_t>[bucket_count]);
+        for (size_t i = 0; i < bucket_count; ++i) table[i].store(0);
+        versions.reset(new atomic<uint64_t>[STRIPES]);
+        for (size_t i = 0; i < STRIPES; ++i) versions[i].store(0);
+    }
+
+    inline uint16_t fingerprint(uint64_t key) const {
+        uint64_t h = hash64(key, seed_main);
+        uint16_t fp = (uint16_t)(h & fp_mask);
+        if (fp == 0) fp = 1;
+        return fp;
+    }
+
+    inline size_t index_hash(uint64_t key) const {
+        uint64_t h = hash64(key, seed_main ^ 0x12345678abcdefULL);
+        return (size_t)(h & (bucket_count - 1));
+    }
+
+    inline size_t alt_index(size_t idx, uint16_t fp) const {
+        uint64_t h = hash64(fp, seed_main ^ 0xf00df00dULL);
+        return (idx ^ (size_t)(h & (bucket_count - 1)));
+    }
+
+    // Slot of the first lane equal to fp in a packed bucket word, or -1.
+    static inline int lane_find(uint64_t word, uint16_t fp) {
+        uint64_t x = word ^ (LANE_ONES * fp);
+        uint64_t z = (x - LANE_ONES) & ~x & LANE_HIGH;
+        return z ? (int)(__builtin_ctzll(z) >> 4) : -1;
+    }
+    static inline uint16_t lane_get(uint64_t word, int s) {
+        return (uint16_t)(word >> (16 * s));
+    }
+    static inline uint64_t lane_set(uint64_t word, int s, uint16_t fp) {
+        uint64_t sh = 16 * (uint64_t)s;
+        return (word & ~(0xffffULL << sh)) | ((uint64_t)fp << sh);
+    }
+
+    inline size_t stripe_of(size_t bucket) const { return bucket & (STRIPES - 1); }
+
+    // spin briefly, then yield so a preempted holder can finish
+    static inline void backoff(int &spins) {
+        if (++spins < 64) {
+            _mm_pause();
+        } else {
+            this_thread::yield();
+        }
+    }
+
+    void lock_stripe(size_t s) {
+        for (int spins = 0;; backoff(spins)) {
+            uint64_t v = versions[s].load(memory_order_relaxed);
+            if (!(v & 1) &&
+                versions[s].compare_exchange_weak(v, v + 1,
+                                                  memory_order_acquire)) {
+                break;
+            }
+        }
+        atomic_thread_fence(memory_order_release);
+    }
+    void unlock_stripe(size_t s) {
+        versions[s].fetch_add(1, memory_order_release);
+    }
+    // stripes are always taken in index order, so two writers never deadlock
+    void lock_pair(size_t a, size_t b) {
+        size_t sa = stripe_of(a), sb = stripe_of(b);
+        if (sa > sb) swap(sa, sb);
+        lock_stripe(sa);
+        if (sb != sa) lock_stripe(sb);
+    }
+    void unlock_pair(size_t a, size_t b) {
+        size_t sa = stripe_of(a), sb = stripe_of(b);
+        unlock_stripe(sa);
+        if (sb != sa) unlock_stripe(sb);
+    }
+
+    inline uint64_t read_begin(size_t s) const {
+        for (int spins = 0;; backoff(spins)) {
+            uint64_t v = versions[s].load(memory_order_acquire);
+            if (!(v & 1)) return v;
+        }
+    }
+
+    // caller holds the stripes of i1 and i2
+    bool place_locked(size_t i1, size_t i2, uint16_t fp) {
+        for (size_t i : {i1, i2}) {
+            uint64_t w = table[i].load(memory_order_relaxed);
+            int s = lane_find(w, 0);
+            if (s >= 0) {
+                table[i].store(lane_set(w, s, fp), memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct PathNode {
+        size_t bucket;
+        int parent;   // index into the BFS node list, -1 for a root
+        int slot;     // slot of the parent bucket whose fp moves here
+    };
+
+    // Unlocked BFS from {i1, i2}; fills `path` root-first and returns true
+    // if some bucket within MAX_BFS_DEPTH hops has a free slot.
+    bool find_path(size_t i1, size_t i2, vector<PathNode> &nodes,
+                   vector<int> &path) const {
+        nodes.clear();
+        nodes.push_back({i1, -1, -1});
+        nodes.push_back({i2, -1, -1});
+        size_t level_begin = 0;
+        for (int depth = 0; depth <= MAX_BFS_DEPTH; ++depth) {
+            size_t level_end = nodes.size();
+            for (size_t idx = level_begin; idx < level_end; ++idx) {
+                uint64_t w = table[nodes[idx].bucket].load(memory_order_relaxed);
+                if (lane_find(w, 0) >= 0) {
+                    path.clear();
+                    for (int k = (int)idx; k >= 0; k = nodes[k].parent) {
+                        path.push_back(k);
+                    }
+                    reverse(path.begin(), path.end());
+                    return true;
+                }
+                if (depth == MAX_BFS_DEPTH) continue;
+                for (int s = 0; s < (int)B; ++s) {
+                    uint16_t f = lane_get(w, s);
+                    nodes.push_back({alt_index(nodes[idx].bucket, f),
+                                     (int)idx, s});
+                }
+            }
+            level_begin = level_end;
+        }
+        return false;
+    }
+
+    // Moves the fp in (from, slot) to a free slot of `to`, if that is still
+    // a valid cuckoo move.
+    bool move_hop(size_t from, int slot, size_t to) {
+        lock_pair(from, to);
+        bool ok = false;
+        uint64_t wf = table[from].load(memory_order_relaxed);
+        uint16_t f = lane_get(wf, slot);
+        if (f == 0) {
+            ok = true;  // already vacated by someone else
+        } else if (alt_index(from, f) == to) {
+            uint64_t wt = table[to].load(memory_order_relaxed);
+            int s = lane_find(wt, 0);
+            if (s >= 0) {
+                table[to].store(lane_set(wt, s, f), memory_order_relaxed);
+                table[from].store(lane_set(wf, slot, 0), memory_order_relaxed);
+                ok = true;
+            }
+        }
+        unlock_pair(from, to);
+        return ok;
+    }
+
+    bool insert(uint64_t key) override {
+        insert_calls.fetch_add(1, memory_order_relaxed);
+
+        uint16_t fp = fingerprint(key);
+        size_t i1 = index_hash(key);
+        size_t i2 = alt_index(i1, fp);
+
+        vector<PathNode> nodes;
+        vector<int> path;
+        for (int attempt = 0; attempt <= MAX_PATH_RETRIES; ++attempt) {
+            lock_pair(i1, i2);
+            bool placed = place_locked(i1, i2, fp);
+            unlock_pair(i1, i2);
+            if (placed) return true;
+
+            if (nodes.capacity() == 0) nodes.reserve(2 << (2 * MAX_BFS_DEPTH));
+            if (!find_path(i1, i2, nodes, path)) break;
+
+            bool ok = true;
+            for (size_t k = path.size() - 1; k >= 1 && ok; --k) {
+                const PathNode &to = nodes[path[k]];
+                const PathNode &from = nodes[path[k - 1]];
+                ok = move_hop(from.bucket, to.slot, to.bucket);
+                if (ok) total_kicks.fetch_add(1, memory_order_relaxed);
+            }
+            if (!ok) path_retries.fetch_add(1, memory_order_relaxed);
+        }
+        failures.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    bool contains(uint64_t key) const override {
+        uint16_t fp = fingerprint(key);
+        size_t i1 = index_hash(key);
+        size_t i2 = alt_index(i1, fp);
+        size_t s1 = stripe_of(i1), s2 = stripe_of(i2);
+
+        for (;;) {
+            uint64_t v1 = read_begin(s1);
+            uint64_t v2 = read_begin(s2);
+            bool hit = lane_find(table[i1].load(memory_order_relaxed), fp) >= 0 ||
+                       lane_find(table[i2].load(memory_order_relaxed), fp) >= 0;
+            atomic_thread_fence(memory_order_acquire);
+            if (versions[s1].load(memory_order_relaxed) == v1 &&
+                versions[s2].load(memory_order_relaxed) == v2) {
+                return hit;
+            }
+        }
+    }
+
+    bool erase(uint64_t key) override {
+        uint16_t fp = fingerprint(key);
+        size_t i1 = index_hash(key);
+        size_t i2 = alt_index(i1, fp);
+
+        lock_pair(i1, i2);
+        bool found = false;
+        for (size_t i : {i1, i2}) {
+            uint64_t w = table[i].load(memory_order_relaxed);
+            int s = lane_find(w, fp);
+            if (s >= 0) {
+                table[i].store(lane_set(w, s, 0), memory_order_relaxed);
+                found = true;
+                break;
+            }
+        }
+        unlock_pair(i1, i2);
+        return found;
+    }
+
+    size_t bytes_used() const override {
+        return bucket_count * sizeof(uint64_t) + STRIPES * sizeof(uint64_t);
+    }
+
+    size_t capacity() const {
+        return bucket_count * B;
+    }
+
+    double failure_rate() const {
+        size_t calls = insert_calls.load();
+        return calls ? (double)failures.load() / (double)calls : 0.0;
+    }
+};
+
+// ====================== Growing Cuckoo Filter ======================
+//
+// Cuckoo filter for an unknown number of keys, as a chain of CuckooFilter
+// stages that double in size. A stage is closed at LOAD (well before kick
+// chains get long), and each new stage is built for a FPR TIGHTEN times
+// smaller (one more fingerprint bit, up to 16), so the chain's compound FPR
+// grows only slowly with its length. A stage is also closed as soon as a
+// kick chain spills into its stash, so the stash never fills and no insert
+// can drop an evicted fingerprint. Lookups probe newest to oldest.
+//
+// No deletes: stages hash with their own seed and fingerprint width, so a
+// key's fingerprint can also match another key's entry in an older stage,
+// and removing that one would be a false negative.
+
+struct GrowingCuckooFilter final : public ApproxFilter {
+    static constexpr double GROWTH = 2.0;
+    static constexpr double TIGHTEN = 0.5;
+    static constexpr double LOAD = 0.9;
+
+    struct Stage {
+        unique_ptr<CuckooFilter> f;
+        size_t limit;   // items at which the stage is closed
+        size_t items;
+    };
+
+    double target_fpr;
+    size_t initial_n;
+    vector<Stage> stages;
+    size_t n_items;
+    size_t insert_calls;
+    size_t failures;
+
+    explicit GrowingCuckooFilter(double target_fpr_, size_t initial_n_ = 1024)
+        : target_fpr(target_fpr_), initial_n(max<size_t>(1, initial_n_)),
+          n_items(0), insert_calls(0), failures(0)
+    {
+        add_stage();
+    }
+
+    void add_stage() {
+        size_t i = stages.size();
+        size_t n = stages.empty()
+            ? initial_n
+            : (size_t)(GROWTH * (double)stages.back().f->capacity() * LOAD);
+        double fpr = target_fpr * (1.0 - TIGHTEN) * pow(TIGHTEN, (double)i);
+        // a lookup compares against up to 2 * bucket_size fingerprints
+        size_t fp_bits = (size_t)ceil(
+            log2(2.0 * CuckooFilter::bucket_size / fpr));
+        auto f = make_unique<CuckooFilter>(n, fpr, fp_bits, 3 + i);
+        size_t limit = (size_t)(LOAD * (double)f->capacity());
+        stages.push_back({std::move(f), limit, 0});
+    }
+
+    bool insert(uint64_t key) override {
+        insert_calls++;
+        if (stages.back().items >= stages.back().limit ||
+            stages.back().f->stash_size > 0) {
+            add_stage();
+        }
+        Stage &s = stages.back();
+        if (!s.f->insert(key)) {
+            failures++;
+            return false;
+        }
+        s.items++;
+        n_items++;
+        return true;
+    }
+
+    bool contains(uint64_t key) const override {
+        for (size_t i = stages.size(); i-- > 0; ) {
+            if (stages[i].f->contains(key)) return true;
+        }
+        return false;
+    }
+
+    bool erase(uint64_t) override {
+        return false; // no deletes
+    }
+
+    size_t bytes_used() const override {
+        size_t bytes = 0;
+        for (const auto &s : stages) bytes += s.f->bytes_used();
+        return bytes;
+    }
+
+    size_t capacity() const {
+        size_t slots = 0;
+        for (const auto &s : stages) slots += s.f->capacity();
+        return slots;
+    }
+
+    double failure_rate() const {
+        return insert_calls ? (double)failures / (double)insert_calls : 0.0;
+    }
+
+    double avg_kicks_per_insert() const {
+        size_t kicks = 0;
+        for (const auto &s : stages) kicks += s.f->total_kicks;
+        return insert_calls ? (double)kicks / (double)insert_calls : 0.0;
+    }
+
+    size_t stash_inserts() const {
+        size_t st = 0;
+        for (const auto &s : stages) st += s.f->stash_inserts;
+        return st;
+    }
+};
+
+// ====================== Quotient Filter (simple, safe) ======================
+//
+// Linear probing over (quotient, remainder) slots. erase() leaves a
+// tombstone that lookups must step over, so each slot also records its
+// distance from home; that is enough to rebuild the table without the
+// original keys. While tombstones fill more than 1/32 of the table, every
+// insert also compacts the next COMPACT_STEP slots in place (each cluster
+// re-laid in home order, no tombstones), sweeping the table with a cursor.
+// Once live + tombstone slots reach MAX_OCCUPANCY a `resizable` filter that
+// is mostly live doubles by moving one remainder bit into the quotient,
+// which doubles the FPR as in Bender et al.'s quotient filter.
+
+struct QuotientFilter final : public ApproxFilter {
+    // A slot is rbits + DIST_BITS wide, bit-packed: the remainder in the
+    // low bits and the distance from home above it. Remainders are never
+    // 0, so a zero remainder marks a free slot: empty when the whole slot
+    // is 0, a tombstone otherwise. Slots are read through an unaligned
+    // 64-bit window, as in FingerprintArray.
+    struct SlotArray {
+        AlignedArray<uint64_t> words;
+        unsigned bits = 0;
+        uint32_t mask = 0;
+
+        static size_t words_for(size_t count, unsigned bits) {
+            return (count * bits + 63) / 64 + 1;
+        }
+
+        void assign(size_t count, unsigned bits_) {
+            set_bits(bits_);
+            words.assign(words_for(count, bits));
+        }
+
+        void set_bits(unsigned bits_) {
+            bits = bits_;
+            mask = (uint32_t)((1ULL << bits) - 1);
+        }
+
+        inline uint32_t get(size_t i) const {
+            size_t bit = i * bits;
+            uint64_t w;
+            memcpy(&w, (const char*)words.data() + (bit >> 3), sizeof(w));
+            return (uint32_t)(w >> (bit & 7)) & mask;
+        }
+
+        inline void set(size_t i, uint32_t v) {
+            size_t bit = i * bits;
+            char* p = (char*)words.data() + (bit >> 3);
+            unsigned sh = bit & 7;
+            uint64_t w;
+            memcpy(&w, p, sizeof(w));
+            w = (w & ~((uint64_t)mask << sh)) | ((uint64_t)v << sh);
+            memcpy(p, &w, sizeof(w));
+        }
+
+        const void* addr(size_t i) const {
+            return (const char*)words.data() + (i * bits >> 3);
+        }
+
+        size_t bytes() const { return words.size() * sizeof(uint64_t); }
+    };
+
+    static constexpr unsigned DIST_BITS = 14;
+    static constexpr size_t MAX_DIST = (1u << DIST_BITS) - 1;
+    static constexpr double MAX_OCCUPANCY = 0.9;  // live + tombstones
+    static constexpr double GROW_LOAD = 0.75;     // live share that grows
+    static constexpr size_t COMPACT_STEP = 64;    // slots swept per insert
+
+    size_t table_size;   // power of two
+    size_t qbits;        // log2(table_size)
+    size_t rbits;        // remainder bits
+    uint64_t seed;
+    SlotArray table;
+
+    size_t n_live;
+    size_t n_tomb;
+    bool compaction;     // reclaim tombstones (off: the plain baseline)
+    bool resizable;      // double a mostly-live table once it fills
+    size_t cursor;       // an empty slot; the next compaction step starts here
+    vector<pair<size_t, uint16_t>> relay;  // one cluster's (home, remainder)
+
+    // stats
+    size_t insert_calls;
+    uint64_t total_probe_len_insert;
+    size_t compactions;
+    size_t resizes;
+
+    QuotientFilter(size_t n,
+                   double target_fpr,
+                   size_t rbits_hint = 8,
+                   uint64_t seed_ = 5,
+                   bool resizable_ = false)
+        : seed(seed_), n_live(0), n_tomb(0), compaction(true),
+          resizable(resizable_), cursor(0), insert_calls(0),
+          total_probe_len_insert(0),
+          compactions(0), resizes(0)
+    {
+        int r_from_p = (int)ceil(-log2(target_fpr));
+        int r = (int)rbits_hint;
+        if (r_from_p > 0) r = max(r, r_from_p);
+        r = max(4, min(16, r));  // clamp to 4..16 bits
+        rbits = (size_t)r;
+
+        double load = 0.8;
+        double needed = (double)n / load;
+        size_t sz = 1;
+        while (sz < (size_t)needed) sz <<= 1;
+        table_size = sz;
+        qbits = (size_t)round(log2((double)table_size));
+
+        table.assign(table_size, (unsigned)rbits + DIST_BITS);
+    }
+
+    // ---- persistence ----
+    // params: table_size, n_live, n_tomb; arrays: table
+    explicit QuotientFilter(const FilterImage &img)
+        : table_size(img.h.params[0]),
+          qbits((size_t)__builtin_ctzll(img.h.params[0])),
+          rbits(img.h.fp_bits),
+          seed(img.h.seed[0]),
+          n_live(img.h.params[1]), n_tomb(img.h.params[2]),
+          compaction(true), resizable(false), cursor(0),
+          insert_calls(0), total_probe_len_insert(0),
+          compactions(0), resizes(0)
+    {
+        table.set_bits((unsigned)rbits + DIST_BITS);
+        img.bind(table.words, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        uint64_t ts = img.h.params[0];
+        if (ts == 0 || (ts & (ts - 1)) ||
+            img.h.fp_bits < 4 || img.h.fp_bits > 16) {
+            return false;
+        }
+        size_t words = SlotArray::words_for(ts, img.h.fp_bits + DIST_BITS);
+        return img.is(FilterType::QUOTIENT, {words * sizeof(uint64_t)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::QUOTIENT);
+        h.seed[0] = seed;
+        h.fp_bits = (uint32_t)rbits;
+        h.params[0] = table_size;
+        h.params[1] = n_live;
+        h.params[2] = n_tomb;
+        return write_filter_file(path, h, {
+            {table.words.data(), table.bytes()}
+        });
     }
 
     inline uint64_t h(uint64_t key) const {
@@ -361,8 +2598,26 @@ struct QuotientFilter : public ApproxFilter {
         q = (size_t)((hval >> rbits) & (table_size - 1));
     }
 
+    inline size_t probe_limit() const {
+        return min(table_size, MAX_DIST + 1);
+    }
+
+    // the slot value of remainder r stored i slots past its home
+    inline uint32_t slot_of(uint16_t r, size_t i) const {
+        return (uint32_t)(i << rbits) | r;
+    }
+    inline bool is_free(uint32_t v) const {
+        return (v & ((1u << rbits) - 1)) == 0;
+    }
+
     bool insert(uint64_t key) override {
         insert_calls++;
+        if ((double)(n_live + n_tomb) >= MAX_OCCUPANCY * (double)table_size) {
+            maintain();
+        }
+        if (compaction && n_tomb >= table_size / 32) {
+            compact_step(COMPACT_STEP);
+        }
 
         uint64_t hv = h(key);
         size_t q;
@@ -372,72 +2627,747 @@ struct QuotientFilter : public ApproxFilter {
         size_t idx = q;
         size_t probes = 0;
 
-        for (size_t i = 0; i < table_size; ++i) {
+        for (size_t i = 0; i < probe_limit(); ++i) {
             probes++;
-            Slot &s = table[idx];
-            if (s.state == 0 || s.state == 2) {
-                s.rem = r;
-                s.state = 1;
+            uint32_t v = table.get(idx);
+            if (is_free(v)) {
+                n_tomb -= v != 0;
+                n_live++;
+                table.set(idx, slot_of(r, i));
                 total_probe_len_insert += probes;
                 return true;
             }
-            if (s.state == 1 && s.rem == r) {
+            if (v == slot_of(r, i)) {
                 total_probe_len_insert += probes;
                 return true;
             }
-            idx = (idx + 1) & (table_size - 1);
+            idx = (idx + 1) & (table_size - 1);
+        }
+        total_probe_len_insert += probes;
+        return false;
+    }
+
+    bool contains(uint64_t key) const override {
+        uint64_t hv = h(key);
+        size_t q;
+        uint16_t r;
+        get_qr(hv, q, r);
+
+        return probe(q, r);
+    }
+
+    // A match must sit exactly i slots from home, so the wanted slot value
+    // steps by one distance unit per probe and each probe is one compare.
+    inline bool probe(size_t q, uint16_t r) const {
+        size_t idx = q;
+        uint32_t want = r;
+        for (size_t i = 0; i < probe_limit(); ++i) {
+            uint32_t v = table.get(idx);
+            if (v == 0) {
+                return false;
+            }
+            if (v == want) {
+                return true;
+            }
+            want += 1u << rbits;
+            idx = (idx + 1) & (table_size - 1);
+        }
+        return false;
+    }
+
+    // ---- batched lookup ----
+    // Hash a group and prefetch every home slot, then run the probes; the
+    // probe usually stays within the prefetched line.
+    static constexpr size_t PIPE = 64;
+
+    void contains_batch(const uint64_t* keys, size_t n,
+                        uint8_t* out) const override {
+        size_t qs[PIPE];
+        uint16_t rs[PIPE];
+
+        for (size_t i = 0; i < n; i += PIPE) {
+            size_t g = min(PIPE, n - i);
+            for (size_t j = 0; j < g; ++j) {
+                get_qr(h(keys[i + j]), qs[j], rs[j]);
+                __builtin_prefetch(table.addr(qs[j]));
+            }
+            for (size_t j = 0; j < g; ++j) {
+                out[i + j] = probe(qs[j], rs[j]) ? 1 : 0;
+            }
+        }
+    }
+
+    bool erase(uint64_t key) override {
+        uint64_t hv = h(key);
+        size_t q;
+        uint16_t r;
+        get_qr(hv, q, r);
+
+        size_t idx = q;
+        for (size_t i = 0; i < probe_limit(); ++i) {
+            uint32_t v = table.get(idx);
+            if (v == 0) {
+                return false;
+            }
+            if (v == slot_of(r, i)) {
+                table.set(idx, 1u << rbits); // tombstone
+                n_live--;
+                n_tomb++;
+                if (compaction) trim_tombstones(idx);
+                return true;
+            }
+            idx = (idx + 1) & (table_size - 1);
+        }
+        return false;
+    }
+
+    // ---- tombstone reclamation ----
+
+    // Tombstones directly before an empty slot end every probe that reaches
+    // them anyway, so they can become empty on the spot.
+    void trim_tombstones(size_t idx) {
+        size_t mask = table_size - 1;
+        if (table.get((idx + 1) & mask) != 0) return;
+        for (uint32_t v; (v = table.get(idx)) != 0 && is_free(v); ) {
+            table.set(idx, 0);
+            n_tomb--;
+            idx = (idx - 1) & mask;
+        }
+    }
+
+    void maintain() {
+        if (resizable && rbits > 4 &&
+            (double)n_live >= GROW_LOAD * (double)table_size) {
+            rehash();
+        }
+    }
+
+    // Re-lays the cluster that starts at `first` (the slot before it is
+    // empty) with its live entries in home order from the cluster start,
+    // which keeps each one reachable from home and drops its tombstones.
+    // A cluster whose new layout would put an entry past MAX_DIST is left
+    // as it is. Returns the cluster's length.
+    size_t relay_cluster(size_t first) {
+        size_t mask = table_size - 1;
+        size_t len = 0, tombs = 0;
+        relay.clear();
+        uint16_t rmask = (uint16_t)((1u << rbits) - 1);
+        for (;; ++len) {
+            uint32_t v = table.get((first + len) & mask);
+            if (v == 0) break;
+            if (is_free(v)) tombs++;
+            else relay.push_back({len - (v >> rbits), (uint16_t)(v & rmask)});
+        }
+        if (tombs == 0) return len;
+
+        sort(relay.begin(), relay.end());
+        size_t cur = 0;
+        for (auto &e : relay) {
+            cur = max(cur, e.first);
+            if (cur - e.first > MAX_DIST) return len;
+            cur++;
+        }
+        for (size_t k = 0; k < len; ++k) table.set((first + k) & mask, 0);
+        cur = 0;
+        for (auto &e : relay) {
+            cur = max(cur, e.first);
+            table.set((first + cur) & mask, slot_of(e.second, cur - e.first));
+            cur++;
+        }
+        n_tomb -= tombs;
+        return len;
+    }
+
+    // Incremental compaction: re-lays whole clusters after the cursor until
+    // at least `budget` slots have been passed, so an insert pays for a
+    // bounded stretch rather than the table. If an insert has filled the
+    // cursor's slot since, the step first moves on to the next empty one.
+    void compact_step(size_t budget) {
+        size_t mask = table_size - 1;
+        for (size_t seen = 0; table.get(cursor) != 0; ) {
+            cursor = (cursor + 1) & mask;
+            if (++seen == table_size) {  // no empty slot at all
+                rehash(false);
+                return;
+            }
+        }
+        for (size_t done = 0; done < budget; ) {
+            size_t first = (cursor + 1) & mask;
+            size_t len = table.get(first) != 0 ? relay_cluster(first) : 0;
+            size_t next = (first + len) & mask;
+            if (next <= cursor) compactions++;  // a sweep has completed
+            cursor = next;
+            done += len + 1;
+        }
+    }
+
+    // One full sweep (the plain variant's explicit compaction).
+    void compact() {
+        compact_step(table_size);
+    }
+
+    // Rebuilds into a new table, doubled (one remainder bit becomes the
+    // low quotient bit) unless grow is false. If some entry would land past
+    // MAX_DIST the old table is kept and false is returned; later inserts
+    // then fail at the probe limit rather than lose keys.
+    bool rehash(bool grow = true) {
+        size_t old_size = table_size;
+        size_t ns = grow ? old_size * 2 : old_size;
+        size_t nr = grow ? rbits - 1 : rbits;
+        SlotArray fresh;
+        fresh.assign(ns, (unsigned)nr + DIST_BITS);
+
+        for (size_t i = 0; i < old_size; ++i) {
+            uint32_t v = table.get(i);
+            if (is_free(v)) continue;
+            size_t q = (i - (v >> rbits)) & (old_size - 1);
+            uint16_t r = (uint16_t)(v & ((1u << rbits) - 1));
+            if (grow) {
+                q = (q << 1) | (r >> nr);
+                r &= (uint16_t)((1u << nr) - 1);
+                if (r == 0) r = 1;
+            }
+            size_t idx = q, d = 0;
+            while (fresh.get(idx) != 0) {
+                idx = (idx + 1) & (ns - 1);
+                d++;
+            }
+            if (d > MAX_DIST) return false;
+            fresh.set(idx, (uint32_t)(d << nr) | r);
+        }
+
+        table = std::move(fresh);
+        table_size = ns;
+        qbits = (size_t)__builtin_ctzll(ns);
+        rbits = nr;
+        n_tomb = 0;
+        cursor = 0;
+        if (grow) resizes++;
+        else compactions++;
+        return true;
+    }
+
+    size_t bytes_used() const override {
+        return table.bytes();
+    }
+
+    size_t capacity() const {
+        return table_size;
+    }
+
+    double avg_probe_len_insert() const {
+        return insert_calls ? (double)total_probe_len_insert /
+                              (double)insert_calls : 0.0;
+    }
+
+    void compute_cluster_stats(double &avg, size_t &maxlen) const {
+        size_t cur = 0;
+        uint64_t sum = 0;
+        size_t count = 0;
+        maxlen = 0;
+
+        for (size_t i = 0; i < table_size; ++i) {
+            if (!is_free(table.get(i))) {
+                cur++;
+            } else {
+                if (cur > 0) {
+                    sum += cur;
+                    count++;
+                    if (cur > maxlen) maxlen = cur;
+                    cur = 0;
+                }
+            }
+        }
+        if (cur > 0) {
+            sum += cur;
+            count++;
+            if (cur > maxlen) maxlen = cur;
+        }
+
+        avg = count ? (double)sum / (double)count : 0.0;
+    }
+};
+
+// ====================== Rank-and-Select Quotient Filter ======================
+//
+// RSQF (Pandey et al.): slots are grouped into 64-slot blocks, each holding
+// an offset, the occupieds/runends bitvectors and 64 bit-packed r-bit
+// remainders. The run for quotient q is found with one rank over occupieds
+// and one select over runends, so a negative lookup never walks a cluster.
+// Runs may spill past the last home slot into a small slack region instead
+// of wrapping around.
+//
+// In counting mode (Pandey et al.'s CQF) a run holds each remainder once,
+// in ascending order, and a multiplicity above one is encoded in the slots
+// right after it:
+//   count 1:  x
+//   count 2:  x x
+//   count c:  x [0] d_k .. d_1 x     (c - 3 in base 2^r - 2)
+// Digits avoid the symbols 0 and x, so the closing x ends the counter; a
+// digit run must start below x (the next remainder would be above it),
+// which a leading 0 guarantees. Remainder 0 is folded into 1 so that x > 0.
+
+// Position of the rank-th (0-based) set bit of x; rank must be < popcount(x).
+inline size_t bitselect64(uint64_t x, size_t rank) {
+#if defined(__BMI2__)
+    return (size_t)__builtin_ctzll(_pdep_u64(1ULL << rank, x));
+#else
+    for (size_t i = 0; i < rank; ++i) x &= x - 1;
+    return (size_t)__builtin_ctzll(x);
+#endif
+}
+
+struct RankSelectQuotientFilter final : public ApproxFilter {
+    static constexpr size_t SLOTS = 64;
+    // per-block word layout
+    static constexpr size_t W_OFFSET = 0, W_OCC = 1, W_RUNEND = 2, W_REM = 3;
+
+    size_t nslots;       // home slots, power of two
+    size_t xnslots;      // nslots plus overflow slack, multiple of 64
+    size_t nblocks;
+    size_t qbits;        // log2(nslots)
+    size_t rbits;        // remainder bits
+    size_t stride;       // words per block (3 + rbits)
+    uint64_t rmask;
+    uint64_t seed;
+    bool counting;       // CQF counter encoding instead of repeated slots
+    AlignedArray<uint64_t> blocks;
+
+    // stats
+    size_t n_items;      // slots in use
+    size_t failures;
+    size_t insert_calls;
+    uint64_t total_probe_len_insert;   // slots shifted + 1, per insert
+
+    RankSelectQuotientFilter(size_t n,
+                             double target_fpr,
+                             size_t rbits_hint = 8,
+                             uint64_t seed_ = 5,
+                             bool counting_ = false)
+        : seed(seed_), counting(counting_), n_items(0), failures(0),
+          insert_calls(0), total_probe_len_insert(0)
+    {
+        int r_from_p = (int)ceil(-log2(target_fpr));
+        int r = (int)rbits_hint;
+        if (r_from_p > 0) r = max(r, r_from_p);
+        r = max(4, min(16, r));
+        rbits = (size_t)r;
+        rmask = (1ULL << rbits) - 1ULL;
+
+        double load = 0.95;
+        double needed = (double)n / load;
+        size_t sz = SLOTS;
+        while (sz < (size_t)needed) sz <<= 1;
+        nslots = sz;
+        qbits = (size_t)round(log2((double)nslots));
+
+        size_t slack = max<size_t>(2 * SLOTS,
+                                   (size_t)(10.0 * sqrt((double)nslots)));
+        xnslots = (nslots + slack + SLOTS - 1) / SLOTS * SLOTS;
+        nblocks = xnslots / SLOTS;
+        stride = W_REM + rbits;
+        blocks.assign(nblocks * stride);
+    }
+
+    // ---- persistence ----
+    // params: nslots, xnslots, n_items, counting; arrays: blocks
+    explicit RankSelectQuotientFilter(const FilterImage &img)
+        : nslots(img.h.params[0]),
+          xnslots(img.h.params[1]),
+          nblocks(img.h.params[1] / SLOTS),
+          qbits((size_t)__builtin_ctzll(img.h.params[0])),
+          rbits(img.h.fp_bits),
+          stride(W_REM + img.h.fp_bits),
+          rmask((1ULL << img.h.fp_bits) - 1ULL),
+          seed(img.h.seed[0]),
+          counting(img.h.params[3] != 0),
+          n_items(img.h.params[2]), failures(0),
+          insert_calls(0), total_probe_len_insert(0)
+    {
+        img.bind(blocks, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        if (p[0] < SLOTS || (p[0] & (p[0] - 1)) || p[1] < p[0] ||
+            p[1] % SLOTS || img.h.fp_bits < 4 || img.h.fp_bits > 16) {
+            return false;
+        }
+        size_t words = p[1] / SLOTS * (W_REM + img.h.fp_bits);
+        return img.is(FilterType::RSQF, {words * sizeof(uint64_t)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::RSQF);
+        h.seed[0] = seed;
+        h.fp_bits = (uint32_t)rbits;
+        h.params[0] = nslots;
+        h.params[1] = xnslots;
+        h.params[2] = n_items;
+        h.params[3] = counting;
+        return write_filter_file(path, h, {
+            {blocks.data(), blocks.size() * sizeof(uint64_t)}
+        });
+    }
+
+    inline const uint64_t* blk(size_t b) const { return &blocks[b * stride]; }
+    inline uint64_t* blk(size_t b) { return &blocks[b * stride]; }
+
+    inline bool get_flag(size_t i, size_t w) const {
+        return (blk(i / SLOTS)[w] >> (i % SLOTS)) & 1ULL;
+    }
+    inline void set_flag(size_t i, size_t w, bool v) {
+        uint64_t &word = blk(i / SLOTS)[w];
+        uint64_t bit = 1ULL << (i % SLOTS);
+        word = v ? (word | bit) : (word & ~bit);
+    }
+    inline bool is_occupied(size_t i) const { return get_flag(i, W_OCC); }
+    inline bool is_runend(size_t i) const { return get_flag(i, W_RUNEND); }
+
+    inline uint64_t get_rem(size_t i) const {
+        const uint64_t* r = blk(i / SLOTS) + W_REM;
+        size_t bit = (i % SLOTS) * rbits;
+        size_t w = bit >> 6, o = bit & 63;
+        uint64_t v = r[w] >> o;
+        if (o + rbits > 64) v |= r[w + 1] << (64 - o);
+        return v & rmask;
+    }
+    inline void set_rem(size_t i, uint64_t v) {
+        uint64_t* r = blk(i / SLOTS) + W_REM;
+        size_t bit = (i % SLOTS) * rbits;
+        size_t w = bit >> 6, o = bit & 63;
+        r[w] = (r[w] & ~(rmask << o)) | (v << o);
+        if (o + rbits > 64) {
+            size_t hi = 64 - o;
+            r[w + 1] = (r[w + 1] & ~(rmask >> hi)) | (v >> hi);
+        }
+    }
+
+    inline void get_qr(uint64_t hval, size_t &q, uint64_t &r) const {
+        r = hval & rmask;
+        if (counting && r == 0) r = 1;
+        q = (size_t)((hval >> rbits) & (nslots - 1));
+    }
+
+    // Offset invariant: blk(b)[W_OFFSET] is the number of slots at the
+    // start of block b covered by runs whose quotient is < 64*b.
+
+    // Runend slot of the last run whose quotient is <= q. If that run ends
+    // before q's block, the result is < 64*(q/64) and therefore < q.
+    int64_t run_end(size_t q) const {
+        size_t b = q / SLOTS;
+        const uint64_t* bp = blk(b);
+        uint64_t off = bp[W_OFFSET];
+        uint64_t below = (2ULL << (q % SLOTS)) - 1;  // bits 0..q%64
+        size_t d = (size_t)__builtin_popcountll(bp[W_OCC] & below);
+        if (d == 0) return (int64_t)(b * SLOTS + off) - 1;
+
+        // the d-th runend at or after the first slot owned by this block
+        size_t pos = b * SLOTS + off;
+        size_t rb = pos / SLOTS;
+        uint64_t word = blk(rb)[W_RUNEND] & (~0ULL << (pos % SLOTS));
+        size_t rank = d - 1;
+        for (;;) {
+            size_t cnt = (size_t)__builtin_popcountll(word);
+            if (rank < cnt) return (int64_t)(rb * SLOTS + bitselect64(word, rank));
+            rank -= cnt;
+            word = blk(++rb)[W_RUNEND];
+        }
+    }
+
+    // First slot >= x not covered by any run (xnslots if none).
+    size_t first_unused(size_t x) const {
+        while (x < xnslots) {
+            int64_t e = run_end(x);
+            if (e < (int64_t)x) return x;
+            x = (size_t)e + 1;
+        }
+        return xnslots;
+    }
+
+    // First slot >= x whose bit is set in bitvector w (xnslots if none).
+    size_t next_set(size_t x, size_t w) const {
+        if (x >= xnslots) return xnslots;
+        size_t b = x / SLOTS;
+        uint64_t word = blk(b)[w] & (~0ULL << (x % SLOTS));
+        while (word == 0) {
+            if (++b >= nblocks) return xnslots;
+            word = blk(b)[w];
+        }
+        return b * SLOTS + (size_t)__builtin_ctzll(word);
+    }
+
+    // First slot of q's run; q must be occupied.
+    size_t run_start(size_t q, size_t e) const {
+        size_t i = e;
+        while (i != q && !is_runend(i - 1)) --i;
+        return i;
+    }
+
+    // Puts remainder v into slot pos of q's run, shifting everything from
+    // pos up to the next unused slot right by one. pos ranges over the run
+    // and one past its end; if q has no run yet, pos must be
+    // max(q, run_end(q) + 1). Returns false when the table is full.
+    bool insert_slot(size_t q, size_t pos, uint64_t v) {
+        bool occ = is_occupied(q);
+        int64_t e = run_end(q);
+        size_t empty = first_unused(pos);
+        if (empty >= xnslots) return false;
+        total_probe_len_insert += empty - pos + 1;
+
+        for (size_t i = empty; i > pos; --i) {
+            set_rem(i, get_rem(i - 1));
+            set_flag(i, W_RUNEND, is_runend(i - 1));
+        }
+        set_rem(pos, v);
+        if (!occ) {
+            set_flag(q, W_OCC, true);
+            set_flag(pos, W_RUNEND, true);
+        } else if ((int64_t)pos == e + 1) {
+            set_flag((size_t)e, W_RUNEND, false);
+            set_flag(pos, W_RUNEND, true);
+        } else {
+            set_flag(pos, W_RUNEND, false);  // q's runend moved to e + 1
+        }
+
+        for (size_t b = q / SLOTS + 1; b <= empty / SLOTS; ++b) {
+            blk(b)[W_OFFSET]++;
+        }
+        n_items++;
+        return true;
+    }
+
+    bool insert(uint64_t key) override {
+        if (counting) return insert(key, 1);
+        insert_calls++;
+
+        size_t q;
+        uint64_t r;
+        get_qr(hash64(key, seed), q, r);
+
+        size_t pos = (size_t)max<int64_t>((int64_t)q, run_end(q) + 1);
+        if (!insert_slot(q, pos, r)) {
+            failures++;
+            return false;
+        }
+        return true;
+    }
+
+    // Adds delta occurrences of key (delta repeated slots outside counting
+    // mode).
+    bool insert(uint64_t key, uint64_t delta) {
+        if (!counting) {
+            for (uint64_t i = 0; i < delta; ++i) {
+                if (!insert(key)) return false;
+            }
+            return true;
+        }
+        insert_calls++;
+
+        size_t q;
+        uint64_t r;
+        get_qr(hash64(key, seed), q, r);
+        size_t p, len;
+        uint64_t c;
+        find_counted(q, r, p, len, c);
+        uint64_t nc = (c + delta < c) ? ~0ULL : c + delta;
+        if (!set_count(q, p, len, r, nc)) {
+            failures++;
+            return false;
+        }
+        return true;
+    }
+
+    // Multiplicity of key; never below the true count.
+    uint64_t count(uint64_t key) const {
+        size_t q;
+        uint64_t r;
+        get_qr(hash64(key, seed), q, r);
+        if (!is_occupied(q)) return 0;
+
+        if (counting) {
+            size_t p, len;
+            uint64_t c;
+            find_counted(q, r, p, len, c);
+            return c;
+        }
+        uint64_t c = 0;
+        for (size_t i = (size_t)run_end(q);; --i) {
+            c += get_rem(i) == r;
+            if (i == q || is_runend(i - 1)) return c;
+        }
+    }
+
+    // ---- counting mode ----
+    static constexpr size_t MAX_ENC = 24;  // 64-bit count, base >= 14
+
+    inline uint64_t counter_base() const { return rmask - 1; }
+
+    // Slots encoding (x, c) for c >= 1; returns how many.
+    size_t encode_count(uint64_t x, uint64_t c, uint64_t* out) const {
+        size_t n = 0;
+        out[n++] = x;
+        if (c == 1) return n;
+        if (c == 2) {
+            out[n++] = x;
+            return n;
+        }
+        uint64_t base = counter_base();
+        uint64_t digits[MAX_ENC];
+        size_t nd = 0;
+        uint64_t v = c - 3;
+        do {
+            digits[nd++] = v % base;
+            v /= base;
+        } while (v);
+        auto sym = [x](uint64_t d) { return d + 1 < x ? d + 1 : d + 2; };
+        if (sym(digits[nd - 1]) > x) out[n++] = 0;
+        while (nd > 0) out[n++] = sym(digits[--nd]);
+        out[n++] = x;
+        return n;
+    }
+
+    // Decodes the entry starting at slot p of a run ending at e; returns
+    // the slot after it.
+    size_t decode_count(size_t p, size_t e, uint64_t &x, uint64_t &c) const {
+        x = get_rem(p);
+        if (p == e) { c = 1; return p + 1; }
+        uint64_t s = get_rem(p + 1);
+        if (s > x) { c = 1; return p + 1; }
+        if (s == x) { c = 2; return p + 2; }
+
+        uint64_t base = counter_base();
+        size_t i = p + 1 + (s == 0);
+        uint64_t v = 0;
+        for (uint64_t d; (d = get_rem(i)) != x; ++i) {
+            v = v * base + (d < x ? d - 1 : d - 2);
+        }
+        c = v + 3;
+        return i + 1;
+    }
+
+    // Finds remainder x in q's run: p is its first slot (or where it would
+    // go to keep the run sorted), len the slots it spans, c its count; len
+    // and c are 0 when absent.
+    void find_counted(size_t q, uint64_t x, size_t &p, size_t &len,
+                      uint64_t &c) const {
+        len = 0;
+        c = 0;
+        if (!is_occupied(q)) {
+            p = (size_t)max<int64_t>((int64_t)q, run_end(q) + 1);
+            return;
+        }
+        size_t e = (size_t)run_end(q);
+        size_t i = run_start(q, e);
+        while (i <= e) {
+            uint64_t y, cy;
+            size_t next = decode_count(i, e, y, cy);
+            if (y >= x) {
+                if (y == x) { len = next - i; c = cy; }
+                break;
+            }
+            i = next;
         }
-        total_probe_len_insert += probes;
-        return false;
+        p = i;
+    }
+
+    // Re-encodes the entry at p (spanning len slots) with count c, growing
+    // or shrinking it in place; c == 0 removes it.
+    bool set_count(size_t q, size_t p, size_t len, uint64_t x, uint64_t c) {
+        uint64_t enc[MAX_ENC];
+        size_t nl = c ? encode_count(x, c, enc) : 0;
+
+        if (nl > len) {
+            // all-or-nothing: make sure every new slot has room first
+            size_t u = p + len;
+            for (size_t k = len; k < nl; ++k, ++u) {
+                u = first_unused(u);
+                if (u >= xnslots) return false;
+            }
+            for (size_t k = len; k < nl; ++k) insert_slot(q, p + k, x);
+        }
+        for (size_t k = nl; k < len; ++k) remove_slot(q, p);
+        for (size_t k = 0; k < nl; ++k) set_rem(p + k, enc[k]);
+        return true;
     }
 
     bool contains(uint64_t key) const override {
-        uint64_t hv = h(key);
+        if (counting) return count(key) > 0;
         size_t q;
-        uint16_t r;
-        get_qr(hv, q, r);
-
-        size_t idx = q;
-        for (size_t i = 0; i < table_size; ++i) {
-            const Slot &s = table[idx];
-            if (s.state == 0) {
-                return false;
-            }
-            if (s.state == 1 && s.rem == r) {
-                return true;
-            }
-            idx = (idx + 1) & (table_size - 1);
+        uint64_t r;
+        get_qr(hash64(key, seed), q, r);
+        if (!is_occupied(q)) return false;
+
+        // walk the run backwards from its runend; it starts at q or right
+        // after the previous run's runend
+        for (size_t i = (size_t)run_end(q);; --i) {
+            if (get_rem(i) == r) return true;
+            if (i == q || is_runend(i - 1)) return false;
         }
-        return false;
     }
 
     bool erase(uint64_t key) override {
-        uint64_t hv = h(key);
         size_t q;
-        uint16_t r;
-        get_qr(hv, q, r);
-
-        size_t idx = q;
-        for (size_t i = 0; i < table_size; ++i) {
-            Slot &s = table[idx];
-            if (s.state == 0) {
-                return false;
-            }
-            if (s.state == 1 && s.rem == r) {
-                s.state = 2; // tombstone
+        uint64_t r;
+        get_qr(hash64(key, seed), q, r);
+        if (!is_occupied(q)) return false;
+
+        if (counting) {
+            size_t p, len;
+            uint64_t c;
+            find_counted(q, r, p, len, c);
+            return c > 0 && set_count(q, p, len, r, c - 1);
+        }
+        size_t e = (size_t)run_end(q);
+        for (size_t i = e;; --i) {
+            if (get_rem(i) == r) {
+                remove_slot(q, i);
                 return true;
             }
-            idx = (idx + 1) & (table_size - 1);
+            if (i == q || is_runend(i - 1)) return false;
         }
-        return false;
+    }
+
+    // Removes slot p of q's run and pulls the rest of the cluster left.
+    void remove_slot(size_t q, size_t p) {
+        size_t e = (size_t)run_end(q);
+        size_t start = run_start(q, e);
+
+        // close the gap inside q's run
+        for (size_t i = p; i < e; ++i) set_rem(i, get_rem(i + 1));
+        set_flag(e, W_RUNEND, false);
+        if (start == e) set_flag(q, W_OCC, false);
+        else            set_flag(e - 1, W_RUNEND, true);
+
+        // pull following runs left while they sit past their home slot
+        size_t hole = e;
+        size_t qq = q;
+        for (;;) {
+            size_t nq = next_set(qq + 1, W_OCC);
+            if (nq > hole) break;
+            size_t en = next_set(hole + 1, W_RUNEND);
+            for (size_t i = hole + 1; i <= en; ++i) {
+                set_rem(i - 1, get_rem(i));
+                set_flag(i - 1, W_RUNEND, is_runend(i));
+            }
+            hole = en;
+            qq = nq;
+        }
+        set_rem(hole, 0);
+        set_flag(hole, W_RUNEND, false);
+
+        for (size_t b = q / SLOTS + 1; b <= hole / SLOTS; ++b) {
+            if (blk(b)[W_OFFSET] > 0) blk(b)[W_OFFSET]--;
+        }
+        n_items--;
     }
 
     size_t bytes_used() const override {
-        return table_size * sizeof(Slot);
+        return blocks.size() * sizeof(uint64_t);
     }
 
     size_t capacity() const {
-        return table_size;
+        return nslots;
     }
 
     double avg_probe_len_insert() const {
@@ -445,22 +3375,25 @@ struct QuotientFilter : public ApproxFilter {
                               (double)insert_calls : 0.0;
     }
 
+    // Clusters are maximal runs of used slots. Slot i is used iff more
+    // quotients in [0, i] are occupied than runs have ended before i.
     void compute_cluster_stats(double &avg, size_t &maxlen) const {
         size_t cur = 0;
         uint64_t sum = 0;
         size_t count = 0;
+        int64_t open_runs = 0;
         maxlen = 0;
 
-        for (size_t i = 0; i < table_size; ++i) {
-            if (table[i].state == 1) {
+        for (size_t i = 0; i < xnslots; ++i) {
+            open_runs += is_occupied(i);
+            if (open_runs > 0) {
                 cur++;
-            } else {
-                if (cur > 0) {
-                    sum += cur;
-                    count++;
-                    if (cur > maxlen) maxlen = cur;
-                    cur = 0;
-                }
+                open_runs -= is_runend(i);
+            } else if (cur > 0) {
+                sum += cur;
+                count++;
+                if (cur > maxlen) maxlen = cur;
+                cur = 0;
             }
         }
         if (cur > 0) {
@@ -474,28 +3407,69 @@ struct QuotientFilter : public ApproxFilter {
 };
 
 // ====================== XOR Filter (static) ======================
+//
+// Slots are W-bit FingerprintArray entries (16 by default); fp_bits is
+// derived from the target FPR and capped at W.
+
+template<unsigned W = 16>
+struct BasicXorFilter final : public ApproxFilter {
+    static constexpr unsigned fp_width = W;
 
-struct XORFilter : public ApproxFilter {
     size_t size;       // number of slots
     uint8_t fp_bits;
     uint64_t seed;
-    vector<uint16_t> fp;
+    FingerprintArray<W> fp;
+    BuildStats last_build;   // single-threaded; see BinaryFuseFilter
 
-    XORFilter(size_t n, double target_fpr,
-              size_t fp_bits_hint = 8,
-              uint64_t seed_ = 7)
+    BasicXorFilter(size_t n, double target_fpr,
+                   size_t fp_bits_hint = 8,
+                   uint64_t seed_ = 7)
         : seed(seed_)
     {
         int f_from_p = (int)ceil(-log2(target_fpr));
         int f = (int)fp_bits_hint;
         if (f_from_p > 0) f = max(f, f_from_p);
-        f = max(4, min(16, f));
+        f = max(4, min((int)W, f));
         fp_bits = (uint8_t)f;
 
         double factor = 1.23;
         size = 1;
         while (size < (size_t)(n * factor)) size <<= 1;
-        fp.assign(size, 0);
+        fp.assign(size);
+    }
+
+    // ---- persistence ----
+    // params: size, W (0 = 16); arrays: fp
+    explicit BasicXorFilter(const FilterImage &img)
+        : size(img.h.params[0]),
+          fp_bits((uint8_t)img.h.fp_bits),
+          seed(img.h.seed[0])
+    {
+        img.bind(fp.data, 0);
+        fp.n = size;
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        uint64_t sz = img.h.params[0];
+        if (sz == 0 || (sz & (sz - 1)) ||
+            img.h.params[1] != W ||
+            img.h.fp_bits < 4 || img.h.fp_bits > W) {
+            return false;
+        }
+        return img.is(FilterType::XOR_FILTER,
+                      {FingerprintArray<W>::words_for(sz) *
+                       sizeof(typename FingerprintArray<W>::word_t)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::XOR_FILTER);
+        h.seed[0] = seed;
+        h.fp_bits = fp_bits;
+        h.params[0] = size;
+        h.params[1] = W;
+        return write_filter_file(path, h, {
+            {fp.data.data(), fp.bytes()}
+        });
     }
 
     struct Edge {
@@ -517,6 +3491,8 @@ struct XORFilter : public ApproxFilter {
     }
 
     bool build(const vector<uint64_t> &keys) {
+        using namespace std::chrono;
+        auto t0 = high_resolution_clock::now();
         size_t n = keys.size();
         vector<Edge> edges(n);
         vector<int> deg(size, 0);
@@ -570,12 +3546,24 @@ struct XORFilter : public ApproxFilter {
             edges[chosen_edge].assigned_index = v;
         }
 
+        size_t scratch = edges.capacity() * sizeof(Edge) +
+                         (deg.capacity() + cur_deg.capacity()) * sizeof(int) +
+                         adj.capacity() * sizeof(vector<int>) +
+                         stack.capacity() * sizeof(int) + edge_used.capacity();
+        for (const auto &a : adj) scratch += a.capacity() * sizeof(int);
+        last_build.peak_bytes = bytes_used() + scratch;
+        last_build.threads = 1;
+        last_build.attempts = 1;
+
         if ((int)stack.size() != (int)n) {
+            last_build.build_ms =
+                duration_cast<nanoseconds>(high_resolution_clock::now() - t0)
+                    .count() * 1e-6;
             cerr << "XORFilter build failed: retry with different seed or bigger size\n";
             return false;
         }
 
-        fill(fp.begin(), fp.end(), 0);
+        fill(fp.data.begin(), fp.data.end(), 0);
         for (int idx = (int)stack.size() - 1; idx >= 0; --idx) {
             int ei = stack[idx];
             Edge &e = edges[ei];
@@ -583,12 +3571,15 @@ struct XORFilter : public ApproxFilter {
             uint32_t i0 = e.h[0], i1 = e.h[1], i2 = e.h[2];
             uint32_t v = (uint32_t)e.assigned_index;
             uint16_t val = f;
-            val ^= fp[i0];
-            val ^= fp[i1];
-            val ^= fp[i2];
-            val ^= fp[v];
-            fp[v] = val;
+            val ^= fp.get(i0);
+            val ^= fp.get(i1);
+            val ^= fp.get(i2);
+            val ^= fp.get(v);
+            fp.set(v, val);
         }
+        last_build.build_ms =
+            duration_cast<nanoseconds>(high_resolution_clock::now() - t0)
+                .count() * 1e-6;
         return true;
     }
 
@@ -600,12 +3591,668 @@ struct XORFilter : public ApproxFilter {
         uint32_t i0 = pos_hash(key, 0);
         uint32_t i1 = pos_hash(key, 1);
         uint32_t i2 = pos_hash(key, 2);
-        uint16_t v = fp[i0] ^ fp[i1] ^ fp[i2];
+        uint16_t v = fp.get(i0) ^ fp.get(i1) ^ fp.get(i2);
         return v == f;
     }
 
     size_t bytes_used() const override {
-        return fp.size() * sizeof(uint16_t);
+        return fp.bytes();
+    }
+};
+
+using XORFilter = BasicXorFilter<16>;
+
+// ====================== Binary Fuse Filter (static) ======================
+//
+// Graf & Lemire binary fuse filter. The table is cut into equal segments and
+// a key's ARITY slots land in ARITY consecutive segments, which keeps the
+// hypergraph peelable at ~1.13x (3-wise) or ~1.08x (4-wise) of n slots.
+// Peeling tracks only a per-slot degree counter and the XOR of incident key
+// hashes, so construction needs no adjacency lists. Keys must be distinct.
+//
+// With shards > 1 the keys are split by hash into independent sub-filters
+// laid out back to back in fp; each is its own peeling problem, which is
+// what lets build() peel them on several threads. The layout depends only
+// on the shard count, never on the thread count.
+
+template<typename FP, int ARITY>
+struct BinaryFuseFilter final : public ApproxFilter {
+    static_assert(ARITY == 3 || ARITY == 4, "arity must be 3 or 4");
+    static_assert(is_same<FP, uint8_t>::value || is_same<FP, uint16_t>::value,
+                  "fingerprints are 8 or 16 bits");
+
+    uint64_t seed;          // seed that produced the current table
+    uint32_t shards;
+    uint32_t segment_length;
+    uint32_t segment_length_mask;
+    uint32_t segment_count;
+    uint32_t segment_count_length;
+    uint32_t array_length;  // slots per shard
+    AlignedArray<FP> fp;
+    BuildStats last_build;
+
+    BinaryFuseFilter(size_t n, uint64_t seed_ = 11, size_t shards_ = 1)
+        : seed(seed_), shards((uint32_t)max<size_t>(1, shards_))
+    {
+        // shards are sized for their expected load plus a 4-sigma margin
+        double per = (double)n / (double)shards;
+        if (shards > 1) per += 4.0 * sqrt(per);
+        double size = max(ceil(per), 2.0);
+
+        double seg_log = (ARITY == 3) ? log(size) / log(3.33) + 2.25
+                                      : log(size) / log(2.91) - 0.5;
+        segment_length = 1u << max(2, min(18, (int)floor(seg_log)));
+        segment_length_mask = segment_length - 1;
+
+        double size_factor = (ARITY == 3)
+            ? max(1.125, 0.875 + 0.25 * log(1000000.0) / log(size))
+            : max(1.075, 0.77 + 0.305 * log(600000.0) / log(size));
+        int64_t capacity = (int64_t)round(size * size_factor);
+        int64_t init_segments = (capacity + segment_length - 1) /
+                                segment_length - (ARITY - 1);
+        int64_t segments = max<int64_t>(init_segments, 1);
+        segment_count = (uint32_t)segments;
+        array_length = (segment_count + ARITY - 1) * segment_length;
+        segment_count_length = segment_count * segment_length;
+        fp.assign((size_t)array_length * shards);
+    }
+
+    // ---- persistence ----
+    // params: shards, segment_length, segment_count, ARITY; arrays: fp
+    explicit BinaryFuseFilter(const FilterImage &img)
+        : seed(img.h.seed[0]),
+          shards((uint32_t)img.h.params[0]),
+          segment_length((uint32_t)img.h.params[1]),
+          segment_length_mask((uint32_t)img.h.params[1] - 1),
+          segment_count((uint32_t)img.h.params[2]),
+          segment_count_length((uint32_t)(img.h.params[2] * img.h.params[1])),
+          array_length((uint32_t)((img.h.params[2] + ARITY - 1) *
+                                  img.h.params[1]))
+    {
+        img.bind(fp, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        if (p[0] == 0 || p[1] == 0 || (p[1] & (p[1] - 1)) || p[2] == 0 ||
+            p[3] != ARITY || img.h.fp_bits != 8 * sizeof(FP)) {
+            return false;
+        }
+        uint64_t slots = (p[2] + ARITY - 1) * p[1] * p[0];
+        return img.is(FilterType::BINARY_FUSE, {slots * sizeof(FP)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::BINARY_FUSE);
+        h.seed[0] = seed;
+        h.fp_bits = 8 * sizeof(FP);
+        h.params[0] = shards;
+        h.params[1] = segment_length;
+        h.params[2] = segment_count;
+        h.params[3] = ARITY;
+        return write_filter_file(path, h, {
+            {fp.data(), fp.size() * sizeof(FP)}
+        });
+    }
+
+    static inline FP fingerprint(uint64_t h) {
+        return (FP)(h ^ (h >> 32));
+    }
+
+    inline uint32_t shard_of(uint64_t h) const {
+        return (uint32_t)(((__uint128_t)(h * 0x9e3779b97f4a7c15ULL) *
+                           shards) >> 64);
+    }
+
+    // Shard-relative slots. Slot j lives in segment (s + j) for a start
+    // segment s picked by the high bits of h; the in-segment offsets come
+    // from disjoint low bit ranges.
+    inline void positions(uint64_t h, uint32_t* p) const {
+        p[0] = (uint32_t)(((__uint128_t)h * segment_count_length) >> 64);
+        for (int j = 1; j < ARITY; ++j) p[j] = p[j - 1] + segment_length;
+        p[1] ^= (uint32_t)(h >> 18) & segment_length_mask;
+        if (ARITY == 3) {
+            p[2] ^= (uint32_t)h & segment_length_mask;
+        } else {
+            p[2] ^= (uint32_t)(h >> 36) & segment_length_mask;
+            p[ARITY - 1] ^= (uint32_t)h & segment_length_mask;
+        }
+    }
+
+    // Per-thread construction buffers, reused across shards.
+    struct PeelScratch {
+        vector<uint64_t> order;      // key hashes, then peel order
+        vector<uint8_t> order_slot;  // which of the ARITY slots was peeled
+        vector<uint8_t> t2count;     // degree << 2 | xor of slot ids
+        vector<uint64_t> t2hash;     // xor of incident hashes
+        vector<uint32_t> alone;
+        vector<uint32_t> start_pos;
+
+        size_t bytes() const {
+            return order.capacity() * sizeof(uint64_t) + order_slot.capacity() +
+                   t2count.capacity() + t2hash.capacity() * sizeof(uint64_t) +
+                   alone.capacity() * sizeof(uint32_t) +
+                   start_pos.capacity() * sizeof(uint32_t);
+        }
+    };
+
+    // Peels the m hashes of one shard and assigns its fingerprints.
+    bool peel_shard(const uint64_t* hs, size_t m, uint32_t shard,
+                    PeelScratch &sc) {
+        sc.order.assign(m + 1, 0);
+        sc.order[m] = 1;  // sentinel so the probe below always stops
+        sc.order_slot.resize(m);
+        sc.t2count.assign(array_length, 0);
+        sc.t2hash.assign(array_length, 0);
+        sc.alone.resize(array_length);
+
+        // bucket the hashes by start segment so the counting pass streams
+        uint32_t block_bits = 1;
+        while ((1u << block_bits) < segment_count) block_bits++;
+        uint32_t blocks = 1u << block_bits;
+        sc.start_pos.resize(blocks);
+        for (uint32_t b = 0; b < blocks; ++b) {
+            sc.start_pos[b] = (uint32_t)(((uint64_t)b * m) >> block_bits);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            uint64_t h = hs[i];
+            uint64_t b = h >> (64 - block_bits);
+            while (sc.order[sc.start_pos[b]] != 0) b = (b + 1) & (blocks - 1);
+            sc.order[sc.start_pos[b]] = h;
+            sc.start_pos[b]++;
+        }
+
+        uint32_t p[ARITY];
+        bool overflow = false;
+        for (size_t i = 0; i < m; ++i) {
+            uint64_t h = sc.order[i];
+            positions(h, p);
+            for (int j = 0; j < ARITY; ++j) {
+                sc.t2count[p[j]] += 4;
+                sc.t2count[p[j]] ^= (uint8_t)j;
+                sc.t2hash[p[j]] ^= h;
+                overflow |= sc.t2count[p[j]] < 4;
+            }
+        }
+        if (overflow) return false;
+
+        size_t qsize = 0;
+        for (uint32_t i = 0; i < array_length; ++i) {
+            sc.alone[qsize] = i;
+            qsize += ((sc.t2count[i] >> 2) == 1) ? 1 : 0;
+        }
+        size_t stack_size = 0;
+        while (qsize > 0) {
+            uint32_t index = sc.alone[--qsize];
+            if ((sc.t2count[index] >> 2) != 1) continue;
+            uint64_t h = sc.t2hash[index];
+            uint8_t found = sc.t2count[index] & 3;
+            sc.order_slot[stack_size] = found;
+            sc.order[stack_size] = h;
+            stack_size++;
+
+            positions(h, p);
+            for (int j = 0; j < ARITY; ++j) {
+                if (j == found) continue;
+                uint32_t other = p[j];
+                sc.alone[qsize] = other;
+                qsize += ((sc.t2count[other] >> 2) == 2) ? 1 : 0;
+                sc.t2count[other] -= 4;
+                sc.t2count[other] ^= (uint8_t)j;
+                sc.t2hash[other] ^= h;
+            }
+        }
+        if (stack_size != m) return false;
+
+        FP* table = &fp[(size_t)shard * array_length];
+        fill(table, table + array_length, (FP)0);
+        for (size_t i = m; i-- > 0;) {
+            uint64_t h = sc.order[i];
+            positions(h, p);
+            int found = sc.order_slot[i];
+            FP v = fingerprint(h);
+            for (int j = 0; j < ARITY; ++j) {
+                if (j != found) v ^= table[p[j]];
+            }
+            table[p[found]] = v;
+        }
+        return true;
+    }
+
+    // Hashing runs on `threads` threads, each counting into its own shard
+    // histogram; the histograms give every thread a private write cursor
+    // per shard for the scatter pass. Shards are then peeled concurrently.
+    bool build(const vector<uint64_t> &keys, int threads = 1) {
+        using namespace std::chrono;
+        auto t0 = high_resolution_clock::now();
+
+        size_t size = keys.size();
+        size_t T = (size_t)max(1, threads);
+        vector<uint64_t> hashes(size);              // grouped by shard
+        vector<size_t> hist(T * shards);            // per-thread histograms
+        vector<size_t> shard_begin(shards + 1);
+        vector<size_t> scratch_bytes(T, 0);
+        SplitMix64 rng(seed);
+        bool ok = false;
+        int attempt = 0;
+
+        for (; attempt < 100 && !ok; ++attempt) {
+            if (attempt > 0) seed = rng.next();
+
+            parallel_run((int)T, [&](int t) {
+                size_t lo = size * t / T, hi = size * (t + 1) / T;
+                size_t* hc = &hist[t * shards];
+                fill(hc, hc + shards, 0);
+                for (size_t i = lo; i < hi; ++i) {
+                    hc[shard_of(hash64(keys[i], seed))]++;
+                }
+            });
+            size_t acc = 0;
+            for (uint32_t s = 0; s < shards; ++s) {
+                shard_begin[s] = acc;
+                for (size_t t = 0; t < T; ++t) {
+                    size_t c = hist[t * shards + s];
+                    hist[t * shards + s] = acc;
+                    acc += c;
+                }
+            }
+            shard_begin[shards] = acc;
+            parallel_run((int)T, [&](int t) {
+                size_t lo = size * t / T, hi = size * (t + 1) / T;
+                size_t* cursor = &hist[t * shards];
+                for (size_t i = lo; i < hi; ++i) {
+                    uint64_t h = hash64(keys[i], seed);
+                    hashes[cursor[shard_of(h)]++] = h;
+                }
+            });
+
+            atomic<uint32_t> next_shard(0);
+            atomic<bool> failed(false);
+            int peelers = (int)min<size_t>(T, shards);
+            parallel_run(peelers, [&](int t) {
+                PeelScratch sc;
+                for (;;) {
+                    uint32_t s = next_shard.fetch_add(1);
+                    if (s >= shards || failed.load()) break;
+                    size_t b = shard_begin[s], e = shard_begin[s + 1];
+                    if (!peel_shard(&hashes[b], e - b, s, sc)) failed = true;
+                }
+                scratch_bytes[t] = max(scratch_bytes[t], sc.bytes());
+            });
+            ok = !failed.load();
+        }
+
+        auto t1 = high_resolution_clock::now();
+        last_build.build_ms = duration_cast<nanoseconds>(t1 - t0).count() * 1e-6;
+        last_build.threads = (int)T;
+        last_build.attempts = attempt;
+        last_build.peak_bytes = bytes_used() + hashes.size() * sizeof(uint64_t) +
+                                hist.size() * sizeof(size_t);
+        for (size_t b : scratch_bytes) last_build.peak_bytes += b;
+
+        if (!ok) {
+            cerr << "BinaryFuseFilter build failed: duplicate keys?\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool insert(uint64_t) override { return false; } // static
+    bool erase(uint64_t) override { return false; }
+
+    bool contains(uint64_t key) const override {
+        uint64_t h = hash64(key, seed);
+        const FP* table = &fp[(size_t)shard_of(h) * array_length];
+        uint32_t p[ARITY];
+        positions(h, p);
+        FP v = fingerprint(h);
+        for (int j = 0; j < ARITY; ++j) v ^= table[p[j]];
+        return v == 0;
+    }
+
+    size_t bytes_used() const override {
+        return fp.size() * sizeof(FP);
+    }
+};
+
+// Shard count for a parallel fuse build: enough shards to keep every thread
+// busy, but no shard below ~256K keys, where the size factor starts to grow.
+size_t fuse_shards_for(size_t n, int threads) {
+    if (threads <= 1) return 1;
+    return max<size_t>(1, min<size_t>(2 * (size_t)threads, n >> 18));
+}
+
+// ====================== Ribbon Filter (static) ======================
+//
+// Dillinger & Walzer standard Ribbon. Each key is one row of a banded
+// linear system over GF(2): a random WIDTH-bit coefficient run (lowest bit
+// set) starting at slot s, with the key's fingerprint as right-hand side.
+// Gaussian elimination is on-the-fly: a row that lands on an occupied
+// pivot is XORed with it and slides right. Back substitution then solves
+// one bit column at a time, and a query recomputes its row times the
+// solution and compares that with its fingerprint.
+//
+// The solution is stored interleaved, WIDTH slots x one column per word,
+// so a query reads r (or r + 1) words from each of two adjacent blocks.
+// Blocks from wide_start on store one extra column; keys starting there
+// get r + 1 result bits, the rest r. The split is sized so the expected
+// FPR is exactly the target, which is what makes bits per key
+// fractional rather than rounded up to a whole fingerprint. The wide
+// blocks sit at the end because elimination only ever moves a row
+// right: every row a wide key is reduced against is itself solved in
+// all r + 1 columns.
+//
+// Homogeneous mode sets every right-hand side to zero: construction can
+// no longer fail, the free variables are random and a query tests for a
+// zero result. The price is a slightly higher FPR at a given overhead.
+// CoeffT is uint64_t or __uint128_t (ribbon width 64 / 128).
+
+inline int ribbon_parity(uint64_t x) { return __builtin_parityll(x); }
+inline int ribbon_parity(__uint128_t x) {
+    return __builtin_parityll((uint64_t)x ^ (uint64_t)(x >> 64));
+}
+inline int ribbon_ctz(uint64_t x) { return __builtin_ctzll(x); }
+inline int ribbon_ctz(__uint128_t x) {
+    uint64_t lo = (uint64_t)x;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t)(x >> 64));
+}
+
+template<typename CoeffT>
+struct BasicRibbonFilter final : public ApproxFilter {
+    static constexpr unsigned WIDTH = 8 * sizeof(CoeffT);
+    static_assert(WIDTH == 64 || WIDTH == 128, "ribbon width is 64 or 128");
+
+    size_t blocks;          // WIDTH slots each
+    uint32_t r;             // result bits of keys outside the wide blocks
+    size_t wide_start;      // first block storing r + 1 columns
+    bool homogeneous;
+    uint64_t seed;
+    AlignedArray<CoeffT> seg;
+    BuildStats last_build;
+
+    // overhead = slots per key; 0 picks one that bands on the first seed
+    // with high probability
+    BasicRibbonFilter(size_t n, double target_fpr, double overhead = 0.0,
+                      bool homogeneous_ = false, uint64_t seed_ = 13)
+        : homogeneous(homogeneous_), seed(seed_)
+    {
+        if (overhead <= 0.0) overhead = default_overhead(n);
+        size_t slots = (size_t)ceil(max<size_t>(n, 1) * overhead);
+        blocks = max<size_t>(2, (slots + WIDTH - 1) / WIDTH);
+
+        // FPR = f * 2^-(r+1) + (1 - f) * 2^-r for a share f of wide keys
+        double p = min(0.5, max(target_fpr, 1e-9));
+        r = (uint32_t)floor(-log2(p));
+        double f = 2.0 - p * ldexp(1.0, (int)r + 1);
+        wide_start = blocks - min(blocks, (size_t)llround(f * blocks));
+        seg.assign(block_base(blocks) + r + 1);
+    }
+
+    // Standard Ribbon needs slack growing with log n before a WIDTH-wide
+    // band stops running out of pivots. Fitted so the first seed bands in
+    // >90% of trials from 10^3 to 10^7 keys; retries cover the rest.
+    static double default_overhead(size_t n) {
+        double lg = log2((double)max<size_t>(n, 2));
+        double slack = 0.7 * lg - (WIDTH == 64 ? 6.0 : 8.0);
+        return 1.0 + max(slack, 4.0) / WIDTH;
+    }
+
+    // ---- persistence ----
+    // params: blocks, WIDTH, wide_start, homogeneous; arrays: seg
+    explicit BasicRibbonFilter(const FilterImage &img)
+        : blocks(img.h.params[0]),
+          r(img.h.fp_bits),
+          wide_start(img.h.params[2]),
+          homogeneous(img.h.params[3] != 0),
+          seed(img.h.seed[0])
+    {
+        img.bind(seg, 0);
+    }
+
+    static bool image_matches(const FilterImage &img) {
+        const uint64_t* p = img.h.params;
+        if (p[0] < 2 || p[1] != WIDTH || p[2] > p[0] ||
+            img.h.fp_bits == 0 || img.h.fp_bits > 31) {
+            return false;
+        }
+        uint64_t words = p[0] * img.h.fp_bits + (p[0] - p[2]) +
+                         img.h.fp_bits + 1;
+        return img.is(FilterType::RIBBON, {words * sizeof(CoeffT)});
+    }
+
+    bool save(const string &path) const {
+        FilterFileHeader h = filter_header(FilterType::RIBBON);
+        h.seed[0] = seed;
+        h.fp_bits = r;
+        h.params[0] = blocks;
+        h.params[1] = WIDTH;
+        h.params[2] = wide_start;
+        h.params[3] = homogeneous;
+        return write_filter_file(path, h, {
+            {seg.data(), seg.size() * sizeof(CoeffT)}
+        });
+    }
+
+    size_t slots() const { return blocks * WIDTH; }
+
+    // First solution word of block b.
+    inline size_t block_base(size_t b) const {
+        return b * r + (b > wide_start ? b - wide_start : 0);
+    }
+
+    inline size_t start_of(uint64_t h) const {
+        return (size_t)(((__uint128_t)h * (slots() - WIDTH + 1)) >> 64);
+    }
+
+    inline CoeffT coeff_of(uint64_t h) const {
+        uint64_t g = hash64(h, seed ^ 0xc0ffee5eedULL);
+        CoeffT c = g;
+        if constexpr (WIDTH == 128) {
+            c = (c << 64) | hash64(g, 0x9e3779b97f4a7c15ULL);
+        }
+        return c | 1;
+    }
+
+    inline uint32_t result_bits(size_t start_block) const {
+        return r + (start_block >= wide_start ? 1 : 0);
+    }
+
+    inline uint32_t expected(uint64_t h, uint32_t bits) const {
+        return homogeneous ? 0 : (uint32_t)h & ((1u << bits) - 1u);
+    }
+
+    // Result bits a key fixes, averaged over keys; what bpe pays for.
+    double mean_result_bits() const {
+        return r + (double)(blocks - wide_start) / (double)blocks;
+    }
+
+    bool build(const vector<uint64_t> &keys) {
+        using namespace std::chrono;
+        auto t0 = high_resolution_clock::now();
+        size_t m = slots();
+        vector<CoeffT> rows(m);
+        vector<uint32_t> rhs(m);
+        SplitMix64 rng(seed);
+        bool ok = false;
+        int attempt = 0;
+
+        for (; attempt < 32 && !ok; ++attempt) {
+            if (attempt > 0) seed = rng.next();
+            fill(rows.begin(), rows.end(), 0);
+            ok = true;
+            for (size_t k = 0; k < keys.size() && ok; ++k) {
+                uint64_t h = hash64(keys[k], seed);
+                size_t s = start_of(h);
+                CoeffT c = coeff_of(h);
+                uint32_t b = expected(h, result_bits(s / WIDTH));
+                for (;;) {
+                    if (rows[s] == 0) {
+                        rows[s] = c;
+                        rhs[s] = b;
+                        break;
+                    }
+                    c ^= rows[s];
+                    b ^= rhs[s];
+                    if (c == 0) {
+                        // dependent row: harmless only if it is 0 = 0
+                        ok = homogeneous || b == 0;
+                        break;
+                    }
+                    int tz = ribbon_ctz(c);
+                    s += tz;
+                    c >>= tz;
+                }
+            }
+        }
+
+        if (ok) {
+            // free variables get random bits: required for homogeneous
+            // filters, where all-zero would match every key
+            Xorshift64 fill_rng(seed);
+            vector<CoeffT> state(r + 1, 0);
+            for (size_t b = blocks; b-- > 0;) {
+                uint32_t cols = result_bits(b);
+                for (size_t i = (b + 1) * WIDTH; i-- > b * WIDTH;) {
+                    CoeffT c = rows[i];
+                    uint32_t bits = c ? rhs[i] : (uint32_t)fill_rng.next();
+                    for (uint32_t j = 0; j < cols; ++j) {
+                        CoeffT t = state[j] << 1;
+                        t |= (CoeffT)(ribbon_parity(c & t) ^ ((bits >> j) & 1));
+                        state[j] = t;
+                    }
+                }
+                CoeffT* out = &seg[block_base(b)];
+                for (uint32_t j = 0; j < cols; ++j) out[j] = state[j];
+            }
+        }
+
+        auto t1 = high_resolution_clock::now();
+        last_build.build_ms = duration_cast<nanoseconds>(t1 - t0).count() * 1e-6;
+        last_build.threads = 1;
+        last_build.attempts = attempt;
+        last_build.peak_bytes = bytes_used() + rows.capacity() * sizeof(CoeffT) +
+                                rhs.capacity() * sizeof(uint32_t);
+        if (!ok) {
+            cerr << "RibbonFilter build failed: duplicate keys or overhead too low\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool insert(uint64_t) override { return false; } // static
+    bool erase(uint64_t) override { return false; }
+
+    bool contains(uint64_t key) const override {
+        uint64_t h = hash64(key, seed);
+        size_t s = start_of(h);
+        CoeffT c = coeff_of(h);
+        size_t b = s / WIDTH;
+        unsigned o = s % WIDTH;
+        CoeffT lo = c << o;
+        CoeffT hi = o ? c >> (WIDTH - o) : 0;
+        const CoeffT* left = &seg[block_base(b)];
+        const CoeffT* right = left + result_bits(b);
+        uint32_t bits = result_bits(b);
+        uint32_t v = 0;
+        for (uint32_t j = 0; j < bits; ++j) {
+            v |= (uint32_t)ribbon_parity((lo & left[j]) ^ (hi & right[j])) << j;
+        }
+        return v == expected(h, bits);
+    }
+
+    size_t bytes_used() const override {
+        return seg.size() * sizeof(CoeffT);
+    }
+};
+
+using RibbonFilter64 = BasicRibbonFilter<uint64_t>;
+using RibbonFilter128 = BasicRibbonFilter<__uint128_t>;
+
+// ====================== Range Filter (dyadic Bloom stack) ======================
+//
+// Answers "may any key lie in [lo, hi]?" (Rosetta, Luo et al.). Level l
+// is a split-block Bloom filter over the prefixes key >> (bottom + l) for
+// l in [0, top - bottom]. A range is cut into maximal aligned dyadic
+// intervals; each is probed at its level and, while the answer is maybe,
+// split into its two halves one level down until the bottom level,
+// where a hit is final. A false positive high up costs only the probes
+// beneath it.
+//
+// bottom == top is the plain prefix Bloom filter: one probe per 2^top
+// prefix the range touches, exact only to that granularity. Ranges wider
+// than MAX_TOP_PROBES top-level intervals (2^(top + 6) keys) answer true
+// without probing, so target_fpr only holds below that width. The levels
+// above the bottom are sized at upper_fpr; at 0.5, each hit's two children
+// make an empty interval lead to one bottom-level probe in expectation,
+// whatever its height. A range covers at most two intervals per level
+// below the top and MAX_TOP_PROBES at the top, so the bottom level gets
+// target_fpr / (2 * (top - bottom) + MAX_TOP_PROBES).
+
+struct RangeBloomFilter final : public ApproxFilter {
+    static constexpr size_t MAX_TOP_PROBES = 64;
+
+    unsigned bottom, top;
+    vector<SplitBlockBloomFilter<8>> levels;  // levels[l]: shift bottom + l
+
+    RangeBloomFilter(size_t n, double target_fpr, unsigned bottom_ = 0,
+                     unsigned top_ = 16, double upper_fpr = 0.5)
+        : bottom(min(bottom_, 63u)), top(max(bottom, min(top_, 63u)))
+    {
+        size_t height = top - bottom;
+        levels.reserve(height + 1);
+        levels.emplace_back(n, target_fpr /
+                               (double)(2 * height + MAX_TOP_PROBES));
+        for (size_t l = 1; l <= height; ++l) {
+            levels.emplace_back(n, upper_fpr, 9 + l);
+        }
+    }
+
+    bool insert(uint64_t key) override {
+        uint64_t p = key >> bottom;
+        for (auto &lv : levels) {
+            lv.insert(p);
+            p >>= 1;
+        }
+        return true;
+    }
+
+    bool erase(uint64_t) override { return false; }
+
+    bool contains(uint64_t key) const override {
+        return levels[0].contains(key >> bottom);
+    }
+
+    // Might a key share prefix p at level l? `probes` counts the Bloom
+    // lookups spent.
+    bool probe(uint64_t p, unsigned l, size_t *probes) const {
+        if (probes) ++*probes;
+        if (!levels[l].contains(p)) return false;
+        if (l == 0) return true;
+        return probe(p << 1, l - 1, probes) ||
+               probe((p << 1) | 1, l - 1, probes);
+    }
+
+    bool may_contain_range(uint64_t lo, uint64_t hi,
+                           size_t *probes = nullptr) const {
+        if (lo > hi) return false;
+        // in bottom-level units; partial units at either end round outwards
+        uint64_t x = lo >> bottom, end = hi >> bottom;
+        unsigned height = top - bottom;
+        if (((end - x) >> height) >= MAX_TOP_PROBES) return true;
+        for (;;) {
+            unsigned l = x ? min<unsigned>(height, __builtin_ctzll(x)) : height;
+            while (l > 0 && end - x < (1ULL << l) - 1) l--;
+            if (probe(x >> l, l, probes)) return true;
+            uint64_t last = x + ((1ULL << l) - 1);
+            if (last == end) return false;
+            x = last + 1;
+        }
+    }
+
+    size_t bytes_used() const override {
+        size_t b = 0;
+        for (const auto &lv : levels) b += lv.bytes_used();
+        return b;
     }
 };
 
@@ -630,79 +4277,446 @@ vector<uint64_t> make_keys(size_t n, uint64_t seed) {
     return keys;
 }
 
+// Zipf(s) ranks in [0, n), rank 0 the most popular, by inverse CDF.
+struct ZipfGenerator {
+    vector<double> cdf;
+    SplitMix64 rng;
+
+    ZipfGenerator(size_t n, double s, uint64_t seed) : cdf(n), rng(seed) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / pow((double)(i + 1), s);
+            cdf[i] = sum;
+        }
+        for (auto &c : cdf) c /= sum;
+    }
+
+    size_t next() {
+        double u = (double)(rng.next() >> 11) * 0x1.0p-53;
+        size_t i = lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return min(i, cdf.size() - 1);
+    }
+};
+
+// Which pool entries a workload touches. Positives and negatives are drawn
+// independently from their own pools with the same shape, so skewed
+// workloads also repeat hot negatives.
+enum class KeyDist {
+    UNIFORM,   // round-robin over the pool
+    ZIPF,      // Zipf(theta) by pool position
+    HOTSPOT,   // hot_ops of the draws hit the first hot_keys of the pool
+    WINDOW     // uniform within a window that slides through the pool
+};
+
+struct KeyDistSpec {
+    KeyDist kind = KeyDist::UNIFORM;
+    double theta = 0.99;     // ZIPF
+    double hot_keys = 0.01;  // HOTSPOT: share of the pool that is hot
+    double hot_ops = 0.9;    // HOTSPOT: share of draws that go to it
+    double window = 0.01;    // WINDOW: width, as a share of the pool
+    size_t slide = 16;       // WINDOW: draws per one-key advance
+};
+
+string key_dist_str(const KeyDistSpec &d) {
+    ostringstream os;
+    switch (d.kind) {
+        case KeyDist::UNIFORM: os << "uniform"; break;
+        case KeyDist::ZIPF:    os << "zipf" << d.theta; break;
+        case KeyDist::HOTSPOT: os << "hotspot" << d.hot_keys << "/" << d.hot_ops; break;
+        case KeyDist::WINDOW:  os << "window" << d.window; break;
+    }
+    return os.str();
+}
+
+// Draws pool indices in [0, n) according to a KeyDistSpec.
+struct KeyPicker {
+    KeyDistSpec d;
+    size_t n;
+    SplitMix64 rng;
+    size_t drawn;
+    unique_ptr<ZipfGenerator> zipf;
+
+    KeyPicker(const KeyDistSpec &d_, size_t n_, uint64_t seed)
+        : d(d_), n(n_), rng(seed), drawn(0)
+    {
+        if (d.kind == KeyDist::ZIPF) {
+            zipf = make_unique<ZipfGenerator>(n, d.theta, seed);
+        }
+    }
+
+    size_t next() {
+        size_t i = drawn++;
+        switch (d.kind) {
+            case KeyDist::UNIFORM:
+                return i % n;
+            case KeyDist::ZIPF:
+                return zipf->next();
+            case KeyDist::HOTSPOT: {
+                size_t hot = min(n, max<size_t>(1, (size_t)(d.hot_keys * n)));
+                double u = (double)(rng.next() >> 11) * 0x1.0p-53;
+                if (u < d.hot_ops || hot == n) return rng.next() % hot;
+                return hot + rng.next() % (n - hot);
+            }
+            case KeyDist::WINDOW: {
+                size_t w = min(n, max<size_t>(1, (size_t)(d.window * n)));
+                size_t base = i / max<size_t>(1, d.slide);
+                return (base + rng.next() % w) % n;
+            }
+        }
+        return 0;
+    }
+};
+
 vector<Op> make_workload(size_t n_ops,
                          WorkloadType wt,
                          double negative_share,
                          const vector<uint64_t> &pos_keys,
-                         const vector<uint64_t> &neg_keys)
+                         const vector<uint64_t> &neg_keys,
+                         const KeyDistSpec &dist = KeyDistSpec())
 {
     vector<Op> ops;
     ops.reserve(n_ops);
-    size_t pos_idx = 0, neg_idx = 0;
-    size_t pos_size = pos_keys.size(), neg_size = neg_keys.size();
+    KeyPicker pos_pick(dist, pos_keys.size(), 0x5eed0001);
+    KeyPicker neg_pick(dist, neg_keys.size(), 0x5eed0002);
+    SplitMix64 rng(0x5eed0003);  // op mix; seeded so runs repeat
+    auto unit = [&] { return (double)(rng.next() >> 11) * 0x1.0p-53; };
 
-    double p_query, p_insert;
+    double p_query;
     if (wt == WorkloadType::READ_ONLY) {
-        p_query = 1.0; p_insert = 0.0;
+        p_query = 1.0;
     } else if (wt == WorkloadType::READ_MOSTLY) {
-        p_query = 0.95; p_insert = 0.05;
+        p_query = 0.95;
     } else { // BALANCED
-        p_query = 0.5; p_insert = 0.5;
+        p_query = 0.5;
     }
 
     for (size_t i = 0; i < n_ops; ++i) {
-        double r = (double)rand() / RAND_MAX;
+        double r = unit();
         Op op{};
         if (r < p_query) {
             op.type = 0;
-            double neg_r = (double)rand() / RAND_MAX;
+            double neg_r = unit();
             if (neg_r < negative_share) {
-                op.key = neg_keys[neg_idx++ % neg_size];
+                op.key = neg_keys[neg_pick.next()];
                 op.should_be_present = false;
             } else {
-                op.key = pos_keys[pos_idx++ % pos_size];
+                op.key = pos_keys[pos_pick.next()];
                 op.should_be_present = true;
             }
         } else {
             op.type = 1;
-            op.key = pos_keys[pos_idx++ % pos_size];
+            op.key = pos_keys[pos_pick.next()];
             op.should_be_present = true;
         }
-        ops.push_back(op);
+        ops.push_back(op);
+    }
+    return ops;
+}
+
+// ---- range queries ----
+
+struct RangeQuery {
+    uint64_t lo, hi;
+    bool nonempty;  // some key of the set lies in [lo, hi]
+};
+
+// `count` ranges over keys in [0, 2^key_bits), widths log-uniform in
+// [2^min_bits, 2^max_bits] (a fixed width when they are equal). About
+// empty_share of them hold no key of `sorted` (ascending), the rest are
+// placed to cover a random key. Empty ranges are found by rejection, so
+// a set too dense for the width may yield fewer of them.
+vector<RangeQuery> make_range_queries(const vector<uint64_t> &sorted,
+                                      size_t count, unsigned min_bits,
+                                      unsigned max_bits, double empty_share,
+                                      unsigned key_bits, uint64_t seed)
+{
+    SplitMix64 rng(seed);
+    uint64_t kmask = key_bits >= 64 ? ~0ULL : (1ULL << key_bits) - 1;
+    auto width = [&] {
+        double u = (double)(rng.next() >> 11) * 0x1.0p-53;
+        double w = exp2(min_bits + u * (max_bits - min_bits));
+        return max<uint64_t>(1, (uint64_t)llround(w));
+    };
+    auto any_in = [&](uint64_t lo, uint64_t hi) {
+        auto it = lower_bound(sorted.begin(), sorted.end(), lo);
+        return it != sorted.end() && *it <= hi;
+    };
+
+    vector<RangeQuery> qs;
+    qs.reserve(count);
+    size_t want_empty = (size_t)llround(empty_share * count);
+    for (size_t tries = 0; qs.size() < want_empty && tries < 20 * count;
+         ++tries) {
+        uint64_t w = width();
+        uint64_t lo = rng.next() & kmask;
+        uint64_t hi = lo + min(w - 1, kmask - lo);
+        if (!any_in(lo, hi)) qs.push_back({lo, hi, false});
+    }
+    while (qs.size() < count && !sorted.empty()) {
+        uint64_t w = width();
+        uint64_t k = sorted[rng.next() % sorted.size()];
+        uint64_t lo = k - min(k, rng.next() % w);
+        uint64_t hi = lo + min(w - 1, kmask - lo);
+        qs.push_back({lo, hi, true});
+    }
+    for (size_t i = qs.size(); i > 1; --i) {
+        swap(qs[i - 1], qs[rng.next() % i]);
+    }
+    return qs;
+}
+
+// ---- binary traces ----
+// A captured key stream, host byte order:
+//   TraceHeader
+//   n_preload x u64   keys already in the set when capture started
+//   n_ops x u64       op keys
+//   n_ops x u8        op types (0 = query, 1 = insert, 2 = delete)
+// Replay builds each filter from the preload keys, then runs the ops.
+
+constexpr char TRACE_MAGIC[8] = {'A', 'M', 'F', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t TRACE_FORMAT_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t n_preload;
+    uint64_t n_ops;
+};
+
+struct Trace {
+    vector<uint64_t> preload;
+    vector<Op> ops;
+
+    size_t writes() const {
+        size_t w = 0;
+        for (const auto &op : ops) w += op.type != 0;
+        return w;
+    }
+};
+
+bool write_trace(const string &path, const Trace &t) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    TraceHeader h{};
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_FORMAT_VERSION;
+    h.n_preload = t.preload.size();
+    h.n_ops = t.ops.size();
+    vector<uint64_t> keys(t.ops.size());
+    vector<uint8_t> types(t.ops.size());
+    for (size_t i = 0; i < t.ops.size(); ++i) {
+        keys[i] = t.ops[i].key;
+        types[i] = t.ops[i].type;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(t.preload.data(), 8, t.preload.size(), f) ==
+                  t.preload.size() &&
+              fwrite(keys.data(), 8, keys.size(), f) == keys.size() &&
+              fwrite(types.data(), 1, types.size(), f) == types.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) remove(path.c_str());
+    return ok;
+}
+
+bool read_trace(const string &path, Trace &t) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    TraceHeader h;
+    struct stat st;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 &&
+              memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) == 0 &&
+              h.version == TRACE_FORMAT_VERSION &&
+              fstat(fileno(f), &st) == 0 &&
+              (uint64_t)st.st_size ==
+                  sizeof(h) + 8 * h.n_preload + 9 * h.n_ops;
+    if (ok) {
+        t.preload.resize(h.n_preload);
+        vector<uint64_t> keys(h.n_ops);
+        vector<uint8_t> types(h.n_ops);
+        ok = fread(t.preload.data(), 8, h.n_preload, f) == h.n_preload &&
+             fread(keys.data(), 8, h.n_ops, f) == h.n_ops &&
+             fread(types.data(), 1, h.n_ops, f) == h.n_ops;
+        t.ops.resize(h.n_ops);
+        for (size_t i = 0; ok && i < h.n_ops; ++i) {
+            if (types[i] > 2) ok = false;
+            t.ops[i] = Op{types[i], keys[i], false};
+        }
     }
-    return ops;
+    fclose(f);
+    return ok;
 }
 
 // ====================== Benchmark Harness ======================
+//
+// The harness loops are templates over the filter type. Instantiated with a
+// concrete (final) filter, contains()/insert() are direct calls the compiler
+// can inline into the loop; instantiated with ApproxFilter they go through
+// the vtable, which is kept so the cost of the indirection can be measured.
+
+// Calls fn with `filter` downcast to the concrete type that stands for ft in
+// the sweeps. A filter of some other type (e.g. 16-lane split-block Bloom)
+// falls back to the virtual interface.
+template<typename Fn>
+auto dispatch_filter(FilterType ft, ApproxFilter &filter, Fn &&fn)
+    -> decltype(fn(filter))
+{
+    switch (ft) {
+        case FilterType::BLOOM_BLOCKED:
+            if (auto *f = dynamic_cast<BlockedBloomFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::BLOOM_SPLIT:
+            if (auto *f = dynamic_cast<SplitBlockBloomFilter<8>*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::BLOOM_CONCURRENT:
+            if (auto *f = dynamic_cast<ConcurrentBloomFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::BLOOM_SCALABLE:
+            if (auto *f = dynamic_cast<ScalableBloomFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::CUCKOO:
+            if (auto *f = dynamic_cast<CuckooFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::CUCKOO_CONCURRENT:
+            if (auto *f = dynamic_cast<ConcurrentCuckooFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::CUCKOO_GROWING:
+            if (auto *f = dynamic_cast<GrowingCuckooFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::QUOTIENT:
+            if (auto *f = dynamic_cast<QuotientFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::RSQF:
+            if (auto *f = dynamic_cast<RankSelectQuotientFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::XOR_FILTER:
+            if (auto *f = dynamic_cast<XORFilter*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::BINARY_FUSE:
+            if (auto *f = dynamic_cast<BinaryFuseFilter<uint8_t, 3>*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+        case FilterType::RIBBON:
+            if (auto *f = dynamic_cast<RibbonFilter128*>(&filter)) {
+                return fn(*f);
+            }
+            break;
+    }
+    return fn(filter);
+}
 
 struct RunResult {
     double seconds;
     double ops_per_sec;
-    double p50_ns, p95_ns, p99_ns;
+    double ns_per_op;  // amortized: total time / ops
+    double p50_ns, p90_ns, p95_ns, p99_ns, p999_ns, max_ns;
 };
 
-RunResult run_workload(ApproxFilter &filter, const vector<Op> &ops,
-                       bool dynamic_filter)
+// Latency quantiles come from a LatencyHistogram of TSC ticks. Unbatched,
+// only one op in every g_sample_every is timed (or a span of
+// g_sample_span ops, each charged span_ticks / span), so the timer stays
+// out of most ops. With batch > 0, runs of consecutive lookups are
+// collected into groups of up to `batch` keys and resolved with one
+// contains_batch() call; a write flushes the pending group first so ops
+// still take effect in order. Each group is timed as a whole and every op
+// in it is charged group_ticks / size, so the quantiles are amortized
+// per-op costs.
+template<typename F>
+RunResult run_workload(F &filter, const vector<Op> &ops,
+                       bool dynamic_filter, size_t batch = 0)
 {
     using namespace std::chrono;
-    vector<double> lat_ns;
-    lat_ns.reserve(ops.size());
+    const TscClock &clk = TscClock::get();
+    LatencyHistogram hist;
+    auto charge = [&](uint64_t t0, uint64_t t1, size_t n) {
+        uint64_t ticks = t1 - t0;
+        ticks = ticks > clk.overhead ? ticks - clk.overhead : 0;
+        hist.record(ticks / n, n);
+    };
 
     auto t0 = high_resolution_clock::now();
-    for (const auto &op : ops) {
-        auto s = high_resolution_clock::now();
-        if (op.type == 0) {
-            (void)filter.contains(op.key);
-        } else if (op.type == 1 && dynamic_filter) {
-            filter.insert(op.key);
-        } else if (op.type == 2 && dynamic_filter) {
-            filter.erase(op.key);
-        } else {
-            (void)filter.contains(op.key);
+    if (batch > 0) {
+        vector<uint64_t> group;
+        group.reserve(batch);
+        vector<uint8_t> out(batch);
+        size_t hits = 0;
+
+        auto flush = [&]() {
+            if (group.empty()) return;
+            uint64_t s = tsc_start();
+            filter.contains_batch(group.data(), group.size(), out.data());
+            charge(s, tsc_stop(), group.size());
+            for (size_t j = 0; j < group.size(); ++j) hits += out[j];
+            group.clear();
+        };
+
+        for (const auto &op : ops) {
+            bool write = dynamic_filter && (op.type == 1 || op.type == 2);
+            if (!write) {
+                group.push_back(op.key);
+                if (group.size() == batch) flush();
+                continue;
+            }
+            flush();
+            uint64_t s = tsc_start();
+            if (op.type == 1) {
+                filter.insert(op.key);
+            } else {
+                filter.erase(op.key);
+            }
+            charge(s, tsc_stop(), 1);
+        }
+        flush();
+        volatile size_t sink = hits;
+        (void)sink;
+    } else {
+        // hits feed a sink so the lookups can't be optimized away once the
+        // filter type is known
+        size_t hits = 0;
+        size_t every = max<size_t>(1, g_sample_every);
+        size_t span = min(max<size_t>(1, g_sample_span), every);
+        size_t phase = 0;   // position within the current window of `every`
+        uint64_t s = 0;
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const Op &op = ops[i];
+            if (phase == 0) s = tsc_start();
+            if (op.type == 0) {
+                hits += filter.contains(op.key);
+            } else if (op.type == 1 && dynamic_filter) {
+                filter.insert(op.key);
+            } else if (op.type == 2 && dynamic_filter) {
+                filter.erase(op.key);
+            } else {
+                hits += filter.contains(op.key);
+            }
+            if (phase < span && (phase + 1 == span || i + 1 == ops.size())) {
+                charge(s, tsc_stop(), phase + 1);
+            }
+            if (++phase == every) phase = 0;
         }
-        auto e = high_resolution_clock::now();
-        double dt = duration_cast<nanoseconds>(e - s).count();
-        lat_ns.push_back(dt);
+        volatile size_t sink = hits;
+        (void)sink;
     }
     auto t1 = high_resolution_clock::now();
     double total_ns = duration_cast<nanoseconds>(t1 - t0).count();
@@ -712,12 +4726,56 @@ RunResult run_workload(ApproxFilter &filter, const vector<Op> &ops,
     RunResult rr;
     rr.seconds = seconds;
     rr.ops_per_sec = ops_per_sec;
-    rr.p50_ns = quantile(lat_ns, 0.5);
-    rr.p95_ns = quantile(lat_ns, 0.95);
-    rr.p99_ns = quantile(lat_ns, 0.99);
+    rr.ns_per_op = total_ns / (double)ops.size();
+    rr.p50_ns = hist.quantile(0.5) * clk.ns_per_tick;
+    rr.p90_ns = hist.quantile(0.9) * clk.ns_per_tick;
+    rr.p95_ns = hist.quantile(0.95) * clk.ns_per_tick;
+    rr.p99_ns = hist.quantile(0.99) * clk.ns_per_tick;
+    rr.p999_ns = hist.quantile(0.999) * clk.ns_per_tick;
+    rr.max_ns = hist.max_value * clk.ns_per_tick;
     return rr;
 }
 
+// Lookup-only counterpart of run_workload: every op's key goes through
+// contains_batch() in groups of `batch`. Only throughput is measured, since
+// per-op timestamps would dominate a batched kernel.
+template<typename F>
+double run_lookup_batched(const F &filter, const vector<Op> &ops,
+                          size_t batch = 64)
+{
+    using namespace std::chrono;
+    vector<uint64_t> keys;
+    keys.reserve(ops.size());
+    for (const auto &op : ops) keys.push_back(op.key);
+    vector<uint8_t> out(batch);
+    size_t hits = 0;
+
+    auto t0 = high_resolution_clock::now();
+    for (size_t i = 0; i < keys.size(); i += batch) {
+        size_t g = min(batch, keys.size() - i);
+        filter.contains_batch(&keys[i], g, out.data());
+        for (size_t j = 0; j < g; ++j) hits += out[j];
+    }
+    auto t1 = high_resolution_clock::now();
+    volatile size_t sink = hits;
+    (void)sink;
+
+    double seconds = duration_cast<nanoseconds>(t1 - t0).count() * 1e-9;
+    return (double)keys.size() / seconds;
+}
+
+size_t count_batch_mismatches(const ApproxFilter &filter,
+                              const vector<uint64_t> &keys)
+{
+    vector<uint8_t> out(keys.size());
+    filter.contains_batch(keys.data(), keys.size(), out.data());
+    size_t bad = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if ((out[i] != 0) != filter.contains(keys[i])) bad++;
+    }
+    return bad;
+}
+
 double measure_fpr(ApproxFilter &filter,
                    const vector<uint64_t> &neg_keys)
 {
@@ -732,14 +4790,126 @@ double bits_per_entry(const ApproxFilter &filter, size_t n_entries) {
     return (double)filter.bytes_used() * 8.0 / (double)n_entries;
 }
 
+// ------------------- Open-Loop Load Generator -------------------
+
+// Replays ops at a fixed offered rate instead of back to back. Each of
+// `threads` clients owns every threads-th op and a schedule of intended
+// start times at rate / threads, spaced evenly or exponentially (Poisson
+// arrivals). A client that falls behind issues at once, but latency is
+// still taken from the intended start, so time spent queued behind a slow
+// op is charged to every op that waited (no coordinated omission).
+// Schedules are drawn before the clock starts: the send loop only waits,
+// issues and timestamps.
+struct OpenLoopResult {
+    double offered_ops_per_sec;
+    double achieved_ops_per_sec;
+    double p50_ns, p90_ns, p99_ns, p999_ns, max_ns;
+};
+
+template<typename F>
+OpenLoopResult run_open_loop(F &filter,
+                             const vector<Op> &ops,
+                             double rate,
+                             int threads,
+                             bool poisson,
+                             bool dynamic,
+                             bool lock_writes)
+{
+    const TscClock &clk = TscClock::get();
+    double gap_ticks = 1e9 * threads / rate / clk.ns_per_tick;
+    uint64_t yield_ticks = (uint64_t)(20000 / clk.ns_per_tick);
+    vector<LatencyHistogram> hists(threads);
+    vector<uint64_t> finished(threads);
+    mutex m;
+
+    // intended start of each client's k-th op, in ticks after `start`
+    vector<vector<uint64_t>> schedule(threads);
+    for (int t = 0; t < threads; ++t) {
+        SplitMix64 rng(0xa11c0de + (uint64_t)t);
+        double at = 0.0;
+        for (size_t i = (size_t)t; i < ops.size(); i += (size_t)threads) {
+            if (poisson) {
+                double u = (double)(rng.next() >> 11) * 0x1.0p-53;
+                at += -log1p(-u) * gap_ticks;
+            } else {
+                at += gap_ticks;
+            }
+            schedule[t].push_back((uint64_t)at);
+        }
+    }
+    // leave 1 ms for the clients to start
+    uint64_t start = tsc_start() + (uint64_t)(1e6 / clk.ns_per_tick);
+
+    auto client = [&](int tid) {
+        LatencyHistogram &hist = hists[tid];
+        const uint64_t *due_at = schedule[tid].data();
+        uint64_t done = start;
+        size_t hits = 0;
+        for (size_t i = (size_t)tid; i < ops.size(); i += (size_t)threads) {
+            uint64_t due = start + *due_at++;
+            // the previous completion stamp stands in for "now" when
+            // already late, so a saturated client reads the clock once
+            for (uint64_t now = done; now < due; now = tsc_start()) {
+                if (due - now > yield_ticks) {
+                    this_thread::yield();
+                } else {
+                    _mm_pause();
+                }
+            }
+
+            const Op &op = ops[i];
+            if (op.type == 0 || !dynamic) {
+                hits += filter.contains(op.key);
+            } else {
+                unique_lock<mutex> lg(m, defer_lock);
+                if (lock_writes) lg.lock();
+                if (op.type == 1) {
+                    filter.insert(op.key);
+                } else {
+                    filter.erase(op.key);
+                }
+            }
+            done = tsc_stop();
+            hist.record(done - due);
+        }
+        finished[tid] = done;
+        volatile size_t sink = hits;
+        (void)sink;
+    };
+    parallel_run(threads, client);
+
+    LatencyHistogram all;
+    for (auto &h : hists) all.merge(h);
+    uint64_t end = *max_element(finished.begin(), finished.end());
+    double seconds = (double)(end - start) * clk.ns_per_tick * 1e-9;
+
+    OpenLoopResult r;
+    r.offered_ops_per_sec = rate;
+    r.achieved_ops_per_sec = seconds > 0 ? ops.size() / seconds : 0.0;
+    r.p50_ns = all.quantile(0.5) * clk.ns_per_tick;
+    r.p90_ns = all.quantile(0.9) * clk.ns_per_tick;
+    r.p99_ns = all.quantile(0.99) * clk.ns_per_tick;
+    r.p999_ns = all.quantile(0.999) * clk.ns_per_tick;
+    r.max_ns = all.max_value * clk.ns_per_tick;
+    return r;
+}
+
 // ====================== Experiment Drivers ======================
 
 string filter_type_str(FilterType ft) {
     switch (ft) {
         case FilterType::BLOOM_BLOCKED: return "bloom_blocked";
+        case FilterType::BLOOM_SPLIT: return "bloom_split";
+        case FilterType::BLOOM_CONCURRENT: return "bloom_concurrent";
+        case FilterType::BLOOM_SCALABLE: return "bloom_scalable";
         case FilterType::CUCKOO: return "cuckoo";
+        case FilterType::CUCKOO_CONCURRENT: return "cuckoo_concurrent";
+        case FilterType::CUCKOO_GROWING: return "cuckoo_growing";
         case FilterType::QUOTIENT: return "quotient";
+        case FilterType::RSQF: return "rsqf";
         case FilterType::XOR_FILTER: return "xor";
+        case FilterType::BINARY_FUSE: return "binary_fuse";
+        case FilterType::RIBBON: return "ribbon";
     }
     return "unknown";
 }
@@ -755,6 +4925,21 @@ string workload_type_str(WorkloadType wt) {
 
 // global trial count for error bars
 int g_trials = 5;
+// threads used to build the static filters
+int g_build_threads = 1;
+// lookup group size for the batch sweep (0 = sweep the default set)
+size_t g_batch = 0;
+// where the persistence benchmark writes its filter files
+string g_persist_dir = "/tmp";
+// trace to replay in trace mode (empty = record a synthetic one first)
+string g_trace_path;
+// client threads issuing requests in open-loop mode
+int g_clients = 1;
+// count hardware events around measured phases (--perf)
+bool g_perf = false;
+// worker placement for the thread-scaling runs (--placement=)
+PlacementSpec g_placement;
+bool g_placement_set = false;
 
 // ------------------- Sanity -------------------
 
@@ -763,6 +4948,88 @@ void sanity_tests() {
     auto pos = make_keys(n, 42);
     auto neg = make_keys(n, 4242);
 
+    {
+        cout << "Sanity: TSC clock + latency histogram\n";
+        const TscClock &clk = TscClock::get();
+        // heavy-tailed values; compare against exact order statistics
+        SplitMix64 rng(7);
+        vector<uint64_t> vals(200000);
+        LatencyHistogram hist;
+        for (auto &v : vals) {
+            double u = (double)(rng.next() >> 11) * 0x1.0p-53;
+            v = (uint64_t)(20.0 / pow(1.0 - u, 0.7));
+            hist.record(v);
+        }
+        sort(vals.begin(), vals.end());
+        double worst = 0.0;
+        for (double q : {0.5, 0.9, 0.99, 0.999}) {
+            uint64_t rank = (uint64_t)ceil(q * vals.size());
+            double exact = (double)vals[rank - 1];
+            worst = max(worst, fabs(hist.quantile(q) - exact) / exact);
+        }
+        cout << "  ns_per_tick=" << clk.ns_per_tick
+             << " overhead_ns=" << clk.overhead * clk.ns_per_tick
+             << " worst_quantile_err=" << worst
+             << " max_exact=" << (hist.quantile(1.0) == vals.back()) << "\n";
+    }
+    {
+        cout << "Sanity: hardware counters\n";
+        // two threads, so inherited counts from the worker are included
+        PerfCounters pc(true);
+        size_t ops = 2 * 1000000;
+        pc.measure([&] {
+            parallel_run(2, [&](int tid) {
+                SplitMix64 rng(tid + 1);
+                uint64_t acc = 0;
+                for (size_t i = 0; i < ops / 2; ++i) acc ^= rng.next();
+                volatile uint64_t sink = acc;
+                (void)sink;
+            });
+            return 0;
+        });
+        if (pc.available()) {
+            cout << "  cycles_per_op=" << pc.per_op(PERF_CYCLES, ops)
+                 << " ipc=" << pc.per_op(PERF_INSTRUCTIONS, ops) /
+                               pc.per_op(PERF_CYCLES, ops)
+                 << " scale=" << pc.scale << "\n";
+        } else {
+            cout << "  unavailable (" << strerror(pc.open_errno)
+                 << "), CSV columns read nan\n";
+        }
+    }
+    {
+        cout << "Sanity: CPU topology + thread placement\n";
+        const CpuTopology &topo = CpuTopology::get();
+        PlacementSpec list;
+        bool parsed = parse_placement("0,2-3", list) && list.cpus.size() == 3 &&
+                      list.cpus[1] == 2 && list.cpus[2] == 3;
+        PlacementSpec bad;
+        parsed = parsed && !parse_placement("3-1", bad);
+        // every policy must visit each allowed CPU exactly once
+        bool perms = true;
+        vector<int> all;
+        for (auto &c : topo.cpus) all.push_back(c.cpu);
+        for (const char *name : {"compact", "scatter", "smt_first"}) {
+            PlacementSpec p;
+            parse_placement(name, p);
+            vector<int> order = placement_order(p);
+            sort(order.begin(), order.end());
+            perms = perms && order == all;
+        }
+        PlacementSpec compact;
+        parse_placement("compact", compact);
+        vector<int> order = placement_order(compact);
+        atomic<int> pinned{0};
+        parallel_run(2, [&](int tid) {
+            int cpu = order[(size_t)tid % order.size()];
+            if (pin_current_thread(cpu) && sched_getcpu() == cpu) pinned++;
+        });
+        cout << "  cpus=" << topo.cpus.size()
+             << " physical_cores=" << topo.physical_cores()
+             << " compact_2t=" << placement_cpus_str(compact, 2)
+             << " parse_ok=" << parsed << " orders_ok=" << perms
+             << " pinned=" << pinned.load() << "/2\n";
+    }
     {
         cout << "Sanity: Blocked Bloom\n";
         BlockedBloomFilter bloom(n, 0.01);
@@ -770,18 +5037,160 @@ void sanity_tests() {
         size_t miss = 0;
         for (auto k : pos) if (!bloom.contains(k)) miss++;
         double fpr = measure_fpr(bloom, neg);
+        size_t batch_bad = count_batch_mismatches(bloom, pos) +
+                           count_batch_mismatches(bloom, neg);
         cout << "  misses=" << miss << " fpr=" << fpr
-             << " bpe=" << bits_per_entry(bloom, n) << "\n";
+             << " bpe=" << bits_per_entry(bloom, n)
+             << " batch_mismatches=" << batch_bad << "\n";
+    }
+    {
+        cout << "Sanity: Split-Block Bloom (32B / 64B buckets)\n";
+        SplitBlockBloomFilter<8> sb32(n, 0.01);
+        SplitBlockBloomFilter<16> sb64(n, 0.01);
+        for (auto k : pos) { sb32.insert(k); sb64.insert(k); }
+        size_t miss = 0;
+        for (auto k : pos) {
+            if (!sb32.contains(k)) miss++;
+            if (!sb64.contains(k)) miss++;
+        }
+        size_t batch_bad = count_batch_mismatches(sb32, neg) +
+                           count_batch_mismatches(sb64, neg);
+        cout << "  misses=" << miss
+             << " fpr32=" << measure_fpr(sb32, neg)
+             << " bpe32=" << bits_per_entry(sb32, n)
+             << " fpr64=" << measure_fpr(sb64, neg)
+             << " bpe64=" << bits_per_entry(sb64, n)
+             << " batch_mismatches=" << batch_bad << "\n";
     }
     {
         cout << "Sanity: Cuckoo\n";
-        CuckooFilter cf(n, 0.01, 4, 8);
+        CuckooFilter cf(n, 0.01, 8);
         for (auto k : pos) cf.insert(k);
         size_t miss = 0;
         for (auto k : pos) if (!cf.contains(k)) miss++;
         double fpr = measure_fpr(cf, neg);
+        size_t batch_bad = count_batch_mismatches(cf, pos) +
+                           count_batch_mismatches(cf, neg);
+        cout << "  misses=" << miss << " fpr=" << fpr
+             << " bpe=" << bits_per_entry(cf, n)
+             << " batch_mismatches=" << batch_bad << "\n";
+
+        BasicCuckooFilter<8> cf8(n, 0.01, 8);
+        for (auto k : pos) cf8.insert(k);
+        miss = 0;
+        for (auto k : pos) if (!cf8.contains(k)) miss++;
+        double fpr8 = measure_fpr(cf8, neg);
+        size_t erased = 0;
+        for (auto k : pos) if (cf8.erase(k)) erased++;
+        cout << "  [8-slot buckets] misses=" << miss
+             << " fpr=" << fpr8
+             << " bpe=" << bits_per_entry(cf8, n)
+             << " erased=" << erased << "/" << n << "\n";
+
+        // 95% load: BFS paths vs. the random walk, and same seed => same table
+        auto fill = [&](CuckooEviction ev, uint64_t seed) {
+            auto f = make_unique<CuckooFilter>(n, 0.01, 8, seed, 500, ev);
+            auto keys = make_keys((size_t)(0.95 * f->capacity()), 77);
+            for (auto k : keys) f->insert(k);
+            size_t fn = 0;
+            for (auto k : keys) if (!f->contains(k)) fn++;
+            return make_pair(std::move(f), fn);
+        };
+        auto [bfs, bfs_miss] = fill(CuckooEviction::BFS, 3);
+        auto [walk, walk_miss] = fill(CuckooEviction::RANDOM_WALK, 3);
+        auto [walk2, walk2_miss] = fill(CuckooEviction::RANDOM_WALK, 3);
+        bool same = equal(walk->table.data.begin(), walk->table.data.end(),
+                          walk2->table.data.begin());
+        cout << "  [95% load] bfs misses=" << bfs_miss
+             << " kicks/insert=" << bfs->avg_kicks_per_insert()
+             << " fallbacks=" << bfs->walk_fallbacks
+             << " | walk misses=" << walk_miss
+             << " kicks/insert=" << walk->avg_kicks_per_insert()
+             << " | deterministic=" << same << "\n";
+
+        // adaptive: reported negatives stop matching, members never do
+        CuckooFilter acf(n, 0.01, 8, 3, 500, CuckooEviction::BFS, true);
+        for (auto k : pos) acf.insert(k);
+        vector<uint64_t> fps;
+        for (auto k : neg) if (acf.contains(k)) fps.push_back(k);
+        for (auto k : fps) acf.report_false_positive(k);
+        size_t still = 0, amiss = 0, aerased = 0;
+        for (auto k : fps) still += acf.contains(k);
+        for (auto k : pos) if (!acf.contains(k)) amiss++;
+        vector<uint8_t> aout(neg.size());
+        acf.contains_batch(neg.data(), neg.size(), aout.data());
+        size_t abatch = 0;
+        for (size_t i = 0; i < neg.size(); ++i) {
+            abatch += aout[i] != (uint8_t)acf.contains(neg[i]);
+        }
+        for (auto k : pos) aerased += acf.erase(k);
+        cout << "  [adaptive] misses=" << amiss
+             << " false_positives=" << fps.size()
+             << " still_matching_after_report=" << still
+             << " adaptations=" << acf.adaptations
+             << " batch_mismatches=" << abatch
+             << " erased=" << aerased << "/" << n << "\n";
+    }
+    {
+        cout << "Sanity: Concurrent Bloom (4 writer threads)\n";
+        ConcurrentBloomFilter cbf(n, 0.01);
+        parallel_run(4, [&](int t) {
+            for (size_t i = (size_t)t; i < pos.size(); i += 4) {
+                cbf.insert(pos[i]);
+            }
+        });
+        ConcurrentBloomFilter ref(n, 0.01);
+        for (auto k : pos) ref.insert(k);
+        size_t miss = 0, differ = 0;
+        for (auto k : pos) if (!cbf.contains(k)) miss++;
+        for (auto k : neg) if (cbf.contains(k) != ref.contains(k)) differ++;
+        cout << "  misses=" << miss << " fpr=" << measure_fpr(cbf, neg)
+             << " bpe=" << bits_per_entry(cbf, n)
+             << " differs_from_serial=" << differ << "\n";
+    }
+    {
+        cout << "Sanity: Concurrent Cuckoo (4 writer threads)\n";
+        ConcurrentCuckooFilter ccf(n, 0.01, 8);
+        parallel_run(4, [&](int t) {
+            for (size_t i = (size_t)t; i < pos.size(); i += 4) {
+                ccf.insert(pos[i]);
+                (void)ccf.contains(neg[i]);
+            }
+        });
+        size_t miss = 0;
+        for (auto k : pos) if (!ccf.contains(k)) miss++;
+        double fpr = measure_fpr(ccf, neg);
         cout << "  misses=" << miss << " fpr=" << fpr
-             << " bpe=" << bits_per_entry(cf, n) << "\n";
+             << " bpe=" << bits_per_entry(ccf, n)
+             << " kicks=" << ccf.total_kicks.load()
+             << " path_retries=" << ccf.path_retries.load()
+             << " failures=" << ccf.failures.load() << "\n";
+    }
+    {
+        cout << "Sanity: Growable (start at 64 keys)\n";
+        ScalableBloomFilter sbf(0.01, 64);
+        GrowingCuckooFilter gcf(0.01, 64);
+        for (auto k : pos) { sbf.insert(k); gcf.insert(k); }
+        size_t miss_b = 0, miss_c = 0;
+        for (auto k : pos) {
+            if (!sbf.contains(k)) miss_b++;
+            if (!gcf.contains(k)) miss_c++;
+        }
+        cout << "  bloom_scalable misses=" << miss_b
+             << " fpr=" << measure_fpr(sbf, neg)
+             << " stages=" << sbf.stages.size()
+             << " bpe=" << bits_per_entry(sbf, n) << "\n";
+        cout << "  cuckoo_growing misses=" << miss_c
+             << " fpr=" << measure_fpr(gcf, neg)
+             << " stages=" << gcf.stages.size()
+             << " failures=" << gcf.failures
+             << " bpe=" << bits_per_entry(gcf, n) << "\n";
+        size_t erased = 0;
+        for (auto k : pos) if (gcf.erase(k)) erased++;
+        miss_c = 0;
+        for (auto k : pos) if (!gcf.contains(k)) miss_c++;
+        cout << "  cuckoo_growing erase_refused=" << (erased == 0)
+             << " misses_after=" << miss_c << "\n";
     }
     {
         cout << "Sanity: Quotient\n";
@@ -790,8 +5199,75 @@ void sanity_tests() {
         size_t miss = 0;
         for (auto k : pos) if (!qf.contains(k)) miss++;
         double fpr = measure_fpr(qf, neg);
+        size_t batch_bad = count_batch_mismatches(qf, pos) +
+                           count_batch_mismatches(qf, neg);
+        cout << "  misses=" << miss << " fpr=" << fpr
+             << " bpe=" << bits_per_entry(qf, n)
+             << " batch_mismatches=" << batch_bad << "\n";
+
+        // steady churn: every insert retires the oldest key. A key that
+        // shares its slot with a retired one goes with it, so a few misses
+        // are expected.
+        auto churn = make_keys(2 * n, 4711);
+        for (size_t i = 0; i < churn.size(); ++i) {
+            qf.erase(i < n ? pos[i] : churn[i - n]);
+            qf.insert(churn[i]);
+        }
+        miss = 0;
+        for (size_t i = churn.size() - n; i < churn.size(); ++i) {
+            if (!qf.contains(churn[i])) miss++;
+        }
+        cout << "  churn misses=" << miss
+             << " tombstones=" << qf.n_tomb
+             << " compactions=" << qf.compactions << "\n";
+
+        QuotientFilter gq(n / 4, 0.001, 8, 5, true);
+        for (auto k : pos) gq.insert(k);
+        miss = 0;
+        for (auto k : pos) if (!gq.contains(k)) miss++;
+        cout << "  resizable misses=" << miss
+             << " resizes=" << gq.resizes
+             << " rbits=" << gq.rbits
+             << " fpr=" << measure_fpr(gq, neg) << "\n";
+    }
+    {
+        cout << "Sanity: Rank-Select Quotient\n";
+        RankSelectQuotientFilter rq(n, 0.01, 8);
+        for (auto k : pos) rq.insert(k);
+        size_t miss = 0;
+        for (auto k : pos) if (!rq.contains(k)) miss++;
+        double fpr = measure_fpr(rq, neg);
+        double bpe = bits_per_entry(rq, n);
+        size_t erased = 0;
+        for (auto k : pos) if (rq.erase(k)) erased++;
         cout << "  misses=" << miss << " fpr=" << fpr
-             << " bpe=" << bits_per_entry(qf, n) << "\n";
+             << " bpe=" << bpe
+             << " erased=" << erased << "/" << n
+             << " left=" << rq.n_items << "\n";
+    }
+    {
+        cout << "Sanity: Counting Quotient\n";
+        RankSelectQuotientFilter cq(n, 0.01, 8, 5, true);
+        size_t distinct = n / 16;
+        for (size_t i = 0; i < distinct; ++i) cq.insert(pos[i], i + 1);
+        for (size_t i = 0; i < distinct; ++i) cq.insert(pos[i]);
+        size_t under = 0, exact = 0;
+        for (size_t i = 0; i < distinct; ++i) {
+            uint64_t c = cq.count(pos[i]);
+            under += c < i + 2;
+            exact += c == i + 2;
+        }
+        size_t slots = cq.n_items;
+        for (size_t i = 0; i < distinct; ++i) {
+            for (size_t j = 0; j < 2; ++j) cq.erase(pos[i]);
+        }
+        size_t left = 0;
+        for (size_t i = 0; i < distinct; ++i) left += cq.count(pos[i]) != i;
+        cout << "  undercounts=" << under
+             << " exact=" << exact << "/" << distinct
+             << " slots=" << slots
+             << " fpr=" << measure_fpr(cq, neg)
+             << " wrong_after_erase=" << left << "\n";
     }
     {
         cout << "Sanity: XOR\n";
@@ -806,6 +5282,270 @@ void sanity_tests() {
                  << " bpe=" << bits_per_entry(xf, n) << "\n";
         }
     }
+    {
+        cout << "Sanity: Ribbon (64/128-bit, standard/homogeneous)\n";
+        auto check = [&](const char *name, auto &rf) {
+            if (!rf.build(pos)) {
+                cout << "  " << name << " build failed\n";
+                return;
+            }
+            size_t miss = 0;
+            for (auto k : pos) if (!rf.contains(k)) miss++;
+            cout << "  " << name << " misses=" << miss
+                 << " fpr=" << measure_fpr(rf, neg)
+                 << " bpe=" << bits_per_entry(rf, n)
+                 << " result_bits=" << rf.mean_result_bits()
+                 << " attempts=" << rf.last_build.attempts << "\n";
+        };
+        RibbonFilter64 r64(n, 0.01);
+        RibbonFilter128 r128(n, 0.01);
+        RibbonFilter128 r128h(n, 0.01, 0.0, true);
+        check("ribbon64", r64);
+        check("ribbon128", r128);
+        check("ribbon128_homog", r128h);
+    }
+    {
+        cout << "Sanity: fingerprint widths (8-bit, bit-packed)\n";
+        // random set/get against a plain vector, across word boundaries
+        auto round_trip = [&](auto w) {
+            constexpr unsigned W = decltype(w)::value;
+            FingerprintArray<W> a;
+            a.assign(1000);
+            vector<uint16_t> ref(1000, 0);
+            SplitMix64 rng(W);
+            for (int i = 0; i < 20000; ++i) {
+                size_t j = rng.next() % ref.size();
+                ref[j] = (uint16_t)(rng.next() & FingerprintArray<W>::MASK);
+                a.set(j, ref[j]);
+            }
+            size_t bad = 0;
+            for (size_t j = 0; j < ref.size(); ++j) bad += a.get(j) != ref[j];
+            return bad;
+        };
+        size_t bad = round_trip(integral_constant<unsigned, 5>()) +
+                     round_trip(integral_constant<unsigned, 12>()) +
+                     round_trip(integral_constant<unsigned, 13>());
+
+        auto cuckoo = [&](auto w) {
+            constexpr unsigned W = decltype(w)::value;
+            BasicCuckooFilter<4, W> cf(n, 0.01, W);
+            for (auto k : pos) cf.insert(k);
+            size_t miss = 0, erased = 0;
+            for (auto k : pos) if (!cf.contains(k)) miss++;
+            double fpr = measure_fpr(cf, neg);
+            double bpe = bits_per_entry(cf, n);
+            for (auto k : pos) erased += cf.erase(k);
+            cout << "  cuckoo_w" << W << " misses=" << miss << " fpr=" << fpr
+                 << " bpe=" << bpe << " erased=" << erased << "/" << n << "\n";
+        };
+        cuckoo(integral_constant<unsigned, 8>());
+        cuckoo(integral_constant<unsigned, 12>());
+
+        BasicXorFilter<10> xf(n, 0.01, 10);
+        size_t miss = 0;
+        if (xf.build(pos)) for (auto k : pos) if (!xf.contains(k)) miss++;
+
+        // packed images load back, and only into the same width
+        string path = g_persist_dir + "/amf_sanity_w_" + to_string(getpid()) +
+                      ".bin";
+        BasicCuckooFilter<4, 12> cf12(n, 0.01, 12);
+        for (auto k : pos) cf12.insert(k);
+        size_t differ = 0;
+        bool loaded = false, refused = false;
+        if (cf12.save(path)) {
+            auto g = load_mmap<BasicCuckooFilter<4, 12>>(path);
+            loaded = g != nullptr;
+            if (g) for (auto k : neg) differ += g->contains(k) != cf12.contains(k);
+            refused = !load_mmap<CuckooFilter>(path);
+            remove(path.c_str());
+        }
+        cout << "  xor_w10 misses=" << miss << " fpr=" << measure_fpr(xf, neg)
+             << " bpe=" << bits_per_entry(xf, n)
+             << " | packed get/set mismatches=" << bad
+             << " | w12 image loaded=" << loaded << " differs=" << differ
+             << " refused_by_w16=" << refused << "\n";
+    }
+    {
+        cout << "Sanity: Binary Fuse (3/4-wise, 8/16-bit)\n";
+        auto check = [&](const char *name, auto &ff) {
+            if (!ff.build(pos)) {
+                cout << "  " << name << " build failed\n";
+                return;
+            }
+            size_t miss = 0;
+            for (auto k : pos) if (!ff.contains(k)) miss++;
+            cout << "  " << name << " misses=" << miss
+                 << " fpr=" << measure_fpr(ff, neg)
+                 << " bpe=" << bits_per_entry(ff, n) << "\n";
+        };
+        BinaryFuseFilter<uint8_t, 3> f38(n);
+        BinaryFuseFilter<uint8_t, 4> f48(n);
+        BinaryFuseFilter<uint16_t, 3> f316(n);
+        BinaryFuseFilter<uint16_t, 4> f416(n);
+        check("fuse3_8", f38);
+        check("fuse4_8", f48);
+        check("fuse3_16", f316);
+        check("fuse4_16", f416);
+
+        // sharded layout must not depend on how many threads built it
+        BinaryFuseFilter<uint8_t, 3> s1(n, 11, 4), s4(n, 11, 4);
+        bool built = s1.build(pos, 1) && s4.build(pos, 4);
+        size_t miss = 0;
+        for (auto k : pos) if (!s4.contains(k)) miss++;
+        cout << "  fuse3_8 x4 shards misses=" << miss
+             << " fpr=" << measure_fpr(s4, neg)
+             << " bpe=" << bits_per_entry(s4, n)
+             << " same_as_1_thread=" << (built && equal(s1.fp.begin(), s1.fp.end(),
+                                                     s4.fp.begin(), s4.fp.end())) << "\n";
+    }
+    {
+        cout << "Sanity: range filter (prefix Bloom / dyadic stack)\n";
+        // keys in a 2^24 universe so short ranges are often non-empty
+        vector<uint64_t> rk = pos;
+        for (auto &k : rk) k &= (1ULL << 24) - 1;
+        vector<uint64_t> sorted = rk;
+        sort(sorted.begin(), sorted.end());
+        auto qs = make_range_queries(sorted, 20000, 0, 10, 0.5, 24, 99);
+        auto check = [&](const char *name, const RangeBloomFilter &rf) {
+            size_t empty = 0, fp = 0, fn = 0, probes = 0;
+            for (const auto &q : qs) {
+                bool hit = rf.may_contain_range(q.lo, q.hi, &probes);
+                if (q.nonempty) fn += !hit;
+                else { empty++; fp += hit; }
+            }
+            cout << "  " << name << " false_negatives=" << fn
+                 << " empty_range_fpr=" << (double)fp / (double)max<size_t>(1, empty)
+                 << " probes/query=" << (double)probes / (double)qs.size()
+                 << " bpe=" << bits_per_entry(rf, n) << "\n";
+        };
+        RangeBloomFilter pb(n, 0.01, 6, 6), ro(n, 0.01, 0, 10);
+        for (auto k : rk) { pb.insert(k); ro.insert(k); }
+        check("prefix_bloom_6", pb);
+        check("rosetta_0_10", ro);
+
+        // ranges touching the top of the key space must not wrap around
+        RangeBloomFilter edge(16, 0.01, 0, 16);
+        edge.insert(~0ULL);
+        edge.insert(0);
+        cout << "  top_of_space=" << edge.may_contain_range(~0ULL - 5, ~0ULL)
+             << " bottom_of_space=" << edge.may_contain_range(0, 3)
+             << " whole_space=" << edge.may_contain_range(0, ~0ULL)
+             << " inverted=" << edge.may_contain_range(9, 3) << "\n";
+    }
+    {
+        cout << "Sanity: page backing (8 MiB table per policy)\n";
+        PageBacking saved = g_page_policy;
+        for (PageBacking req : {PageBacking::NORMAL, PageBacking::THP,
+                                PageBacking::HUGETLB}) {
+            g_page_policy = req;
+            page_stats_reset();
+            long kb0 = huge_page_kb();
+            AlignedArray<uint64_t> a((8 << 20) / sizeof(uint64_t));
+            size_t nonzero = 0, wrong = 0;
+            for (size_t i = 0; i < a.size(); i += 512) nonzero += a[i] != 0;
+            for (size_t i = 0; i < a.size(); i += 512) a[i] = i;
+            for (size_t i = 0; i < a.size(); i += 512) wrong += a[i] != i;
+            long kb1 = huge_page_kb();
+            cout << "  requested=" << page_backing_str(req)
+                 << " obtained=" << page_backing_obtained()
+                 << " huge_kb=" << (kb1 - kb0)
+                 << " not_zeroed=" << nonzero << " wrong=" << wrong << "\n";
+        }
+        g_page_policy = saved;
+    }
+    {
+        cout << "Sanity: save + load_mmap round trip\n";
+        string path = g_persist_dir + "/amf_sanity_" + to_string(getpid()) +
+                      ".bin";
+        auto check = [&](const char *name, const auto &f) {
+            using F = typename remove_cv<
+                typename remove_reference<decltype(f)>::type>::type;
+            bool saved = f.save(path);
+            auto g = saved ? load_mmap<F>(path) : nullptr;
+            size_t differ = 0;
+            if (g) {
+                for (auto k : pos) differ += f.contains(k) != g->contains(k);
+                for (auto k : neg) differ += f.contains(k) != g->contains(k);
+            }
+            // a different filter type must be refused
+            bool refused = !load_mmap<XORFilter>(path) ||
+                           is_same<F, XORFilter>::value;
+            cout << "  " << name << " loaded=" << (g != nullptr)
+                 << " differs=" << differ << " refuses_other_type=" << refused
+                 << "\n";
+            remove(path.c_str());
+        };
+
+        BlockedBloomFilter bloom(n, 0.01);
+        SplitBlockBloomFilter<16> sb(n, 0.01);
+        CuckooFilter cf(n, 0.01, 8);
+        QuotientFilter qf(n, 0.01, 8);
+        RankSelectQuotientFilter rq(n, 0.01, 8);
+        for (auto k : pos) {
+            bloom.insert(k); sb.insert(k); cf.insert(k);
+            qf.insert(k); rq.insert(k);
+        }
+        XORFilter xf(n, 0.01, 8);
+        BinaryFuseFilter<uint16_t, 4> ff(n);
+        RibbonFilter128 rf(n, 0.01);
+        xf.build(pos);
+        ff.build(pos);
+        rf.build(pos);
+        check("bloom_blocked", bloom);
+        check("bloom_split64", sb);
+        check("cuckoo", cf);
+        check("quotient", qf);
+        check("rsqf", rq);
+        check("xor", xf);
+        check("fuse4_16", ff);
+        check("ribbon128", rf);
+    }
+    {
+        cout << "Sanity: key distributions + trace round trip\n";
+        KeyDistSpec hot;
+        hot.kind = KeyDist::HOTSPOT;
+        KeyPicker pick(hot, n, 1);
+        size_t hot_hits = 0;
+        for (int i = 0; i < 100000; ++i) hot_hits += pick.next() < n / 100;
+
+        KeyDistSpec zipf;
+        zipf.kind = KeyDist::ZIPF;
+        Trace tr;
+        tr.preload = pos;
+        tr.ops = make_workload(50000, WorkloadType::BALANCED, 0.5, pos, neg,
+                               zipf);
+        string path = g_persist_dir + "/amf_sanity_trace_" +
+                      to_string(getpid()) + ".bin";
+        Trace back;
+        bool ok = write_trace(path, tr) && read_trace(path, back);
+        bool same = ok && back.preload == tr.preload &&
+                    back.ops.size() == tr.ops.size();
+        for (size_t i = 0; same && i < tr.ops.size(); ++i) {
+            same = back.ops[i].type == tr.ops[i].type &&
+                   back.ops[i].key == tr.ops[i].key;
+        }
+        // a truncated file must be refused
+        bool refused = truncate(path.c_str(), 100) == 0 &&
+                       !read_trace(path, back);
+        remove(path.c_str());
+        cout << "  hotspot_share=" << hot_hits / 1e5
+             << " trace_round_trip=" << same
+             << " refuses_truncated=" << refused << "\n";
+    }
+    {
+        cout << "Sanity: open-loop pacing (200K ops/s offered)\n";
+        BlockedBloomFilter bloom(n, 0.01);
+        for (auto k : pos) bloom.insert(k);
+        auto ops = make_workload(20000, WorkloadType::READ_ONLY, 0.5, pos, neg);
+        for (bool poisson : {false, true}) {
+            OpenLoopResult r = run_open_loop(bloom, ops, 2e5, 1, poisson,
+                                             false, false);
+            cout << "  " << (poisson ? "poisson" : "constant")
+                 << " achieved/offered="
+                 << r.achieved_ops_per_sec / r.offered_ops_per_sec
+                 << " p50_ns=" << r.p50_ns << "\n";
+        }
+    }
 }
 
 // ------------------- Simple Sweep (lookup throughput & tails) -------------------
@@ -815,7 +5555,11 @@ void run_simple_sweep() {
             "ops,ops_per_sec_mean,ops_per_sec_std,"
             "p50_ns_mean,p50_ns_std,"
             "p95_ns_mean,p95_ns_std,"
-            "p99_ns_mean,p99_ns_std\n";
+            "p99_ns_mean,p99_ns_std,"
+            "batch_ops_per_sec_mean,batch_ops_per_sec_std,"
+            "virtual_ops_per_sec_mean,virtual_ops_per_sec_std,"
+            "p90_ns_mean,p999_ns_mean,max_ns_mean,"
+         << PerfCounters::csv_header() << "\n";
 
     vector<size_t> Ns = {1000000};
     vector<double> target_fprs = {0.01};
@@ -829,20 +5573,32 @@ void run_simple_sweep() {
             BlockedBloomFilter bloom(n, target_fpr);
             for (auto k : pos) bloom.insert(k);
 
-            CuckooFilter cf(n, target_fpr, 4, 8);
+            SplitBlockBloomFilter<8> sbbf(n, target_fpr);
+            for (auto k : pos) sbbf.insert(k);
+
+            CuckooFilter cf(n, target_fpr, 8);
             for (auto k : pos) cf.insert(k);
 
             QuotientFilter qf(n, target_fpr, 8);
             for (auto k : pos) qf.insert(k);
 
+            RankSelectQuotientFilter rq(n, target_fpr, 8);
+            for (auto k : pos) rq.insert(k);
+
             XORFilter xf(n, target_fpr, 8);
             bool ok = xf.build(pos);
 
+            BinaryFuseFilter<uint8_t, 3> bf(n);
+            bool bf_ok = bf.build(pos);
+
             vector<pair<FilterType, ApproxFilter*>> filters;
             filters.push_back({FilterType::BLOOM_BLOCKED, &bloom});
+            filters.push_back({FilterType::BLOOM_SPLIT, &sbbf});
             filters.push_back({FilterType::CUCKOO, &cf});
             filters.push_back({FilterType::QUOTIENT, &qf});
+            filters.push_back({FilterType::RSQF, &rq});
             if (ok) filters.push_back({FilterType::XOR_FILTER, &xf});
+            if (bf_ok) filters.push_back({FilterType::BINARY_FUSE, &bf});
 
             for (auto [ft, fptr] : filters) {
                 double fpr = measure_fpr(*fptr, neg);
@@ -857,15 +5613,32 @@ void run_simple_sweep() {
                     );
                     bool dynamic =
                         (ft == FilterType::CUCKOO ||
-                         ft == FilterType::QUOTIENT);
-                    vector<double> ops_ps, p50s, p95s, p99s;
+                         ft == FilterType::QUOTIENT ||
+                         ft == FilterType::RSQF);
+                    vector<double> ops_ps, p50s, p95s, p99s, batch_ps;
+                    vector<double> virt_ps, p90s, p999s, maxs;
+                    PerfCounters pc(g_perf);
 
                     for (int t = 0; t < g_trials; ++t) {
-                        RunResult rr = run_workload(*fptr, ops, dynamic);
+                        RunResult rr = pc.measure([&] {
+                            return dispatch_filter(ft, *fptr, [&](auto &f) {
+                                return run_workload(f, ops, dynamic);
+                            });
+                        });
                         ops_ps.push_back(rr.ops_per_sec);
                         p50s.push_back(rr.p50_ns);
                         p95s.push_back(rr.p95_ns);
                         p99s.push_back(rr.p99_ns);
+                        p90s.push_back(rr.p90_ns);
+                        p999s.push_back(rr.p999_ns);
+                        maxs.push_back(rr.max_ns);
+                        batch_ps.push_back(
+                            dispatch_filter(ft, *fptr, [&](auto &f) {
+                                return run_lookup_batched(f, ops);
+                            }));
+                        virt_ps.push_back(
+                            run_workload<ApproxFilter>(*fptr, ops, dynamic)
+                                .ops_per_sec);
                     }
 
                     double ops_mean = mean_vec(ops_ps);
@@ -876,6 +5649,8 @@ void run_simple_sweep() {
                     double p95_std  = stddev_vec(p95s);
                     double p99_mean = mean_vec(p99s);
                     double p99_std  = stddev_vec(p99s);
+                    double batch_mean = mean_vec(batch_ps);
+                    double batch_std  = stddev_vec(batch_ps);
 
                     cout << filter_type_str(ft) << ","
                          << n << ","
@@ -892,8 +5667,16 @@ void run_simple_sweep() {
                          << p95_mean << ","
                          << p95_std << ","
                          << p99_mean << ","
-                         << p99_std
-                         << "\n";
+                         << p99_std << ","
+                         << batch_mean << ","
+                         << batch_std << ","
+                         << mean_vec(virt_ps) << ","
+                         << stddev_vec(virt_ps) << ","
+                         << mean_vec(p90s) << ","
+                         << mean_vec(p999s) << ","
+                         << mean_vec(maxs) << ",";
+                    pc.write_csv(cout, (double)ops.size() * g_trials);
+                    cout << "\n";
                 }
             }
         }
@@ -902,11 +5685,198 @@ void run_simple_sweep() {
 
 // ------------------- Dynamic Insert/Delete + Load-Factor Sweeps -------------------
 
+// Shared load-factor sweep for the quotient-style filters; QF needs
+// capacity(), avg_probe_len_insert() and compute_cluster_stats().
+template<typename QF>
+void dynamic_sweep_quotient(const string &name, size_t n, double target_fpr,
+                            const vector<uint64_t> &keys,
+                            const vector<double> &load_factors)
+{
+    QF base_qf(n, target_fpr, 8);
+    size_t capacity = base_qf.capacity();
+
+    for (double lf : load_factors) {
+        size_t inserts = (size_t)floor(lf * (double)capacity);
+
+        vector<double> ops_insert, ops_delete;
+        double sum_probe = 0.0;
+        double sum_avg_cluster = 0.0;
+        double sum_max_cluster = 0.0;
+
+        for (int t = 0; t < g_trials; ++t) {
+            QF qf(n, target_fpr, 8);
+
+            using namespace std::chrono;
+            auto t0 = high_resolution_clock::now();
+            for (size_t i = 0; i < inserts; ++i) {
+                qf.insert(keys[i]);
+            }
+            auto t1 = high_resolution_clock::now();
+            double ns_insert = duration_cast<nanoseconds>(t1 - t0).count();
+            double sec_insert = ns_insert * 1e-9;
+            ops_insert.push_back(inserts / sec_insert);
+
+            double avg_cluster_len = 0.0;
+            size_t max_cluster_len = 0;
+            qf.compute_cluster_stats(avg_cluster_len, max_cluster_len);
+            sum_probe       += qf.avg_probe_len_insert();
+            sum_avg_cluster += avg_cluster_len;
+            sum_max_cluster += (double)max_cluster_len;
+
+            auto t2 = high_resolution_clock::now();
+            for (size_t i = 0; i < inserts; ++i) {
+                qf.erase(keys[i]);
+            }
+            auto t3 = high_resolution_clock::now();
+            double ns_delete = duration_cast<nanoseconds>(t3 - t2).count();
+            double sec_delete = ns_delete * 1e-9;
+            ops_delete.push_back(inserts / sec_delete);
+        }
+
+        double ops_ins_mean = mean_vec(ops_insert);
+        double ops_ins_std  = stddev_vec(ops_insert);
+        double ops_del_mean = mean_vec(ops_delete);
+        double ops_del_std  = stddev_vec(ops_delete);
+        double avg_probe    = sum_probe / g_trials;
+        double avg_cluster  = sum_avg_cluster / g_trials;
+        double avg_max_cl   = sum_max_cluster / g_trials;
+
+        cout << name << ","
+             << n << ","
+             << target_fpr << ","
+             << lf << ","
+             << "insert,"
+             << inserts << ","
+             << ops_ins_mean << ","
+             << ops_ins_std << ","
+             << 0.0 << ","
+             << 0.0 << ","
+             << 0 << ","
+             << avg_probe << ","
+             << avg_cluster << ","
+             << (size_t)avg_max_cl << ","
+             << 0.0 << ","
+             << 0.0 << ","
+             << 1 << ","
+             << 0.0
+             << "\n";
+
+        cout << name << ","
+             << n << ","
+             << target_fpr << ","
+             << lf << ","
+             << "delete,"
+             << inserts << ","
+             << ops_del_mean << ","
+             << ops_del_std << ","
+             << 0.0 << ","
+             << 0.0 << ","
+             << 0 << ","
+             << avg_probe << ","
+             << avg_cluster << ","
+             << (size_t)avg_max_cl << ","
+             << 0.0 << ","
+             << 0.0 << ","
+             << 1 << ","
+             << 0.0
+             << "\n";
+    }
+}
+
+struct GrowthStats {
+    double load = 0.0;
+    double failure_rate = 0.0;
+    double avg_kicks = 0.0;
+    size_t stash_inserts = 0;
+    size_t stages = 1;
+};
+
+GrowthStats growth_stats(const ScalableBloomFilter &f) {
+    GrowthStats g;
+    g.load = (double)f.n_items / (double)f.capacity();
+    g.stages = f.stages.size();
+    return g;
+}
+GrowthStats growth_stats(const GrowingCuckooFilter &f) {
+    GrowthStats g;
+    g.load = (double)f.n_items / (double)f.capacity();
+    g.failure_rate = f.failure_rate();
+    g.avg_kicks = f.avg_kicks_per_insert();
+    g.stash_inserts = f.stash_inserts();
+    g.stages = f.stages.size();
+    return g;
+}
+GrowthStats growth_stats(const CuckooFilter &f) {
+    GrowthStats g;
+    g.load = (double)(f.insert_calls - f.failures) / (double)f.capacity();
+    g.failure_rate = f.failure_rate();
+    g.avg_kicks = f.avg_kicks_per_insert();
+    g.stash_inserts = f.stash_inserts;
+    return g;
+}
+
+// Inserts keys one at a time into a filter that starts small (or, for the
+// fixed-size baselines, is sized for less than the final count) and emits a
+// "grow" row at every doubling of the key count: interval throughput, the
+// slowest single insert of the interval, and FPR at that point. `design_n`
+// is the count the load column is relative to for filters without a
+// capacity() of their own (0 = use growth_stats).
+template<typename F>
+void growth_sweep(const string &name, F &f, double target_fpr,
+                  const vector<uint64_t> &keys, const vector<uint64_t> &neg,
+                  size_t design_n = 0)
+{
+    using namespace std::chrono;
+    size_t done = 0;
+    for (size_t mark = 1024; done < keys.size(); mark *= 2) {
+        size_t end = min(mark, keys.size());
+        size_t ops = end - done;
+        double max_ns = 0.0;
+        auto t0 = high_resolution_clock::now();
+        for (; done < end; ++done) {
+            auto s = high_resolution_clock::now();
+            f.insert(keys[done]);
+            auto e = high_resolution_clock::now();
+            max_ns = max(max_ns, (double)duration_cast<nanoseconds>(e - s).count());
+        }
+        auto t1 = high_resolution_clock::now();
+        double sec = duration_cast<nanoseconds>(t1 - t0).count() * 1e-9;
+
+        GrowthStats g;
+        if constexpr (is_same<F, BlockedBloomFilter>::value) {
+            g.load = (double)done / (double)design_n;
+        } else {
+            g = growth_stats(f);
+        }
+
+        cout << name << ","
+             << done << ","
+             << target_fpr << ","
+             << g.load << ","
+             << "grow,"
+             << ops << ","
+             << ops / sec << ","
+             << 0.0 << ","
+             << g.failure_rate << ","
+             << g.avg_kicks << ","
+             << g.stash_inserts << ","
+             << 0.0 << ","
+             << 0.0 << ","
+             << 0 << ","
+             << measure_fpr(f, neg) << ","
+             << max_ns << ","
+             << g.stages << ","
+             << 0.0
+             << "\n";
+    }
+}
+
 void run_dynamic_sweep() {
     cout << "filter,n,target_fpr,load_factor,phase,"
             "ops,ops_per_sec_mean,ops_per_sec_std,"
             "failure_rate,avg_kicks_per_insert,stash_inserts,"
-            "avg_probe_len_insert,avg_cluster_len,max_cluster_len\n";
+            "avg_probe_len_insert,avg_cluster_len,max_cluster_len,"
+            "achieved_fpr,max_insert_ns,stages,p99_insert_ns\n";
 
     size_t n = 1000000;
     double target_fpr = 0.01;
@@ -919,9 +5889,17 @@ void run_dynamic_sweep() {
     }
 
     // ---------------- Cuckoo Filter ----------------
-    {
-        CuckooFilter base_cf(n, target_fpr, 4, 8);
+    // BFS path search ("cuckoo") vs. the random walk it replaced. Insert
+    // tails come from a second, per-insert TSC-timed fill, so the
+    // throughput columns carry no timer overhead.
+    vector<pair<CuckooEviction, string>> evictions = {
+        {CuckooEviction::BFS, "cuckoo"},
+        {CuckooEviction::RANDOM_WALK, "cuckoo_walk"}
+    };
+    for (auto &[eviction, name] : evictions) {
+        CuckooFilter base_cf(n, target_fpr, 8);
         size_t capacity = base_cf.capacity();
+        const TscClock &clk = TscClock::get();
 
         for (double lf : load_factors) {
             size_t inserts = (size_t)floor(lf * (double)capacity);
@@ -930,9 +5908,10 @@ void run_dynamic_sweep() {
             double sum_fail = 0.0;
             double sum_kicks = 0.0;
             double sum_stash = 0.0;
+            LatencyHistogram insert_hist;
 
             for (int t = 0; t < g_trials; ++t) {
-                CuckooFilter cf(n, target_fpr, 4, 8);
+                CuckooFilter cf(n, target_fpr, 8, 3, 500, eviction);
 
                 using namespace std::chrono;
                 auto t0 = high_resolution_clock::now();
@@ -956,7 +5935,17 @@ void run_dynamic_sweep() {
                 sum_fail  += cf.failure_rate();
                 sum_kicks += cf.avg_kicks_per_insert();
                 sum_stash += cf.stash_inserts;
+
+                CuckooFilter timed(n, target_fpr, 8, 3, 500, eviction);
+                for (size_t i = 0; i < inserts; ++i) {
+                    uint64_t a = tsc_start();
+                    timed.insert(keys[i]);
+                    uint64_t d = tsc_stop() - a;
+                    insert_hist.record(d > clk.overhead ? d - clk.overhead : 0);
+                }
             }
+            double p99_ins_ns = insert_hist.quantile(0.99) * clk.ns_per_tick;
+            double max_ins_ns = insert_hist.quantile(1.0) * clk.ns_per_tick;
 
             double ops_ins_mean = mean_vec(ops_insert);
             double ops_ins_std  = stddev_vec(ops_insert);
@@ -966,7 +5955,7 @@ void run_dynamic_sweep() {
             double kicks_mean   = sum_kicks / g_trials;
             double stash_mean   = sum_stash / g_trials;
 
-            cout << "cuckoo,"
+            cout << name << ","
                  << n << ","
                  << target_fpr << ","
                  << lf << ","
@@ -979,10 +5968,14 @@ void run_dynamic_sweep() {
                  << stash_mean << ","
                  << 0.0 << ","
                  << 0.0 << ","
-                 << 0
+                 << 0 << ","
+                 << 0.0 << ","
+                 << max_ins_ns << ","
+                 << 1 << ","
+                 << p99_ins_ns
                  << "\n";
 
-            cout << "cuckoo,"
+            cout << name << ","
                  << n << ","
                  << target_fpr << ","
                  << lf << ","
@@ -995,100 +5988,50 @@ void run_dynamic_sweep() {
                  << stash_mean << ","
                  << 0.0 << ","
                  << 0.0 << ","
-                 << 0
+                 << 0 << ","
+                 << 0.0 << ","
+                 << 0.0 << ","
+                 << 1 << ","
+                 << 0.0
                  << "\n";
         }
     }
 
-    // ---------------- Quotient Filter ----------------
-    {
-        QuotientFilter base_qf(n, target_fpr, 8);
-        size_t capacity = base_qf.capacity();
-
-        for (double lf : load_factors) {
-            size_t inserts = (size_t)floor(lf * (double)capacity);
-
-            vector<double> ops_insert, ops_delete;
-            double sum_probe = 0.0;
-            double sum_avg_cluster = 0.0;
-            double sum_max_cluster = 0.0;
-
-            for (int t = 0; t < g_trials; ++t) {
-                QuotientFilter qf(n, target_fpr, 8);
-
-                using namespace std::chrono;
-                auto t0 = high_resolution_clock::now();
-                for (size_t i = 0; i < inserts; ++i) {
-                    qf.insert(keys[i]);
-                }
-                auto t1 = high_resolution_clock::now();
-                double ns_insert = duration_cast<nanoseconds>(t1 - t0).count();
-                double sec_insert = ns_insert * 1e-9;
-                ops_insert.push_back(inserts / sec_insert);
+    // ---------------- Quotient Filters ----------------
+    dynamic_sweep_quotient<QuotientFilter>("quotient", n, target_fpr,
+                                           keys, load_factors);
+    dynamic_sweep_quotient<RankSelectQuotientFilter>("rsqf", n, target_fpr,
+                                                     keys, load_factors);
 
-                double avg_cluster_len = 0.0;
-                size_t max_cluster_len = 0;
-                qf.compute_cluster_stats(avg_cluster_len, max_cluster_len);
-                sum_probe       += qf.avg_probe_len_insert();
-                sum_avg_cluster += avg_cluster_len;
-                sum_max_cluster += (double)max_cluster_len;
+    // ---------------- Growth from 1K to 10M keys ----------------
+    // Growable filters start at 1024 keys; the fixed-size baselines are
+    // sized for n and overfilled. Insert-only: neither growable filter
+    // supports deletes.
+    {
+        cerr << "run_dynamic_sweep: bloom_scalable and cuckoo_growing do not "
+                "support deletes; their rows are grow phase only\n";
+        auto grow_keys = make_keys(10000000, 1001);
+        auto grow_neg = make_keys(100000, 1002);
 
-                auto t2 = high_resolution_clock::now();
-                for (size_t i = 0; i < inserts; ++i) {
-                    qf.erase(keys[i]);
-                }
-                auto t3 = high_resolution_clock::now();
-                double ns_delete = duration_cast<nanoseconds>(t3 - t2).count();
-                double sec_delete = ns_delete * 1e-9;
-                ops_delete.push_back(inserts / sec_delete);
-            }
+        ScalableBloomFilter sbf(target_fpr, 1024);
+        growth_sweep("bloom_scalable", sbf, target_fpr, grow_keys, grow_neg);
 
-            double ops_ins_mean = mean_vec(ops_insert);
-            double ops_ins_std  = stddev_vec(ops_insert);
-            double ops_del_mean = mean_vec(ops_delete);
-            double ops_del_std  = stddev_vec(ops_delete);
-            double avg_probe    = sum_probe / g_trials;
-            double avg_cluster  = sum_avg_cluster / g_trials;
-            double avg_max_cl   = sum_max_cluster / g_trials;
+        GrowingCuckooFilter gcf(target_fpr, 1024);
+        growth_sweep("cuckoo_growing", gcf, target_fpr, grow_keys, grow_neg);
 
-            cout << "quotient,"
-                 << n << ","
-                 << target_fpr << ","
-                 << lf << ","
-                 << "insert,"
-                 << inserts << ","
-                 << ops_ins_mean << ","
-                 << ops_ins_std << ","
-                 << 0.0 << ","
-                 << 0.0 << ","
-                 << 0 << ","
-                 << avg_probe << ","
-                 << avg_cluster << ","
-                 << (size_t)avg_max_cl
-                 << "\n";
+        BlockedBloomFilter fixed_bloom(n, target_fpr);
+        growth_sweep("bloom_blocked_fixed", fixed_bloom, target_fpr,
+                     grow_keys, grow_neg, n);
 
-            cout << "quotient,"
-                 << n << ","
-                 << target_fpr << ","
-                 << lf << ","
-                 << "delete,"
-                 << inserts << ","
-                 << ops_del_mean << ","
-                 << ops_del_std << ","
-                 << 0.0 << ","
-                 << 0.0 << ","
-                 << 0 << ","
-                 << avg_probe << ","
-                 << avg_cluster << ","
-                 << (size_t)avg_max_cl
-                 << "\n";
-        }
+        CuckooFilter fixed_cf(n, target_fpr, 8);
+        growth_sweep("cuckoo_fixed", fixed_cf, target_fpr, grow_keys, grow_neg);
     }
 }
 
 // ------------------- Threaded Throughput Helper -------------------
 
-double run_threaded_throughput(ApproxFilter &filter,
+template<typename F>
+double run_threaded_throughput(F &filter,
                                WorkloadType wt,
                                double neg_share,
                                const vector<uint64_t> &pos,
@@ -1096,25 +6039,38 @@ double run_threaded_throughput(ApproxFilter &filter,
                                int threads,
                                size_t total_ops,
                                bool dynamic,
-                               bool lock_writes)
+                               bool lock_writes,
+                               bool lock_reads = false,
+                               bool churn = false,
+                               const PlacementSpec &placement = PlacementSpec(),
+                               vector<double> *per_thread_ops_per_sec = nullptr)
 {
     using namespace std::chrono;
     mutex m;  // for coarse-grain write locking when needed
+    vector<int> cpus = placement_order(placement);
+    vector<double> thread_secs(threads, 0.0);
 
     auto worker = [&](int tid, size_t start_op, size_t ops_this_thread) {
+        if (!cpus.empty()) pin_current_thread(cpus[(size_t)tid % cpus.size()]);
+        auto w0 = high_resolution_clock::now();
         SplitMix64 rng(123456789ULL + (uint64_t)tid * 1337ULL);
-        double p_query, p_insert;
+        double p_query;
         if (wt == WorkloadType::READ_ONLY) {
-            p_query = 1.0; p_insert = 0.0;
+            p_query = 1.0;
         } else if (wt == WorkloadType::READ_MOSTLY) {
-            p_query = 0.95; p_insert = 0.05;
+            p_query = 0.95;
         } else {
-            p_query = 0.5; p_insert = 0.5;
+            p_query = 0.5;
         }
 
         size_t pos_sz = pos.size();
         size_t neg_sz = neg.size();
         size_t local_insert_count = 0;
+        size_t hits = 0;
+        // churn: writes alternate insert/erase of a private key so the
+        // occupancy stays put no matter how many ops run
+        uint64_t churn_key = 0;
+        bool churn_live = false;
 
         for (size_t i = 0; i < ops_this_thread; ++i) {
             double r = (double)rng.next() /
@@ -1128,7 +6084,22 @@ double run_threaded_throughput(ApproxFilter &filter,
                 } else {
                     key = pos[(start_op + i) % pos_sz];
                 }
-                (void)filter.contains(key);
+                if (lock_reads) {
+                    lock_guard<mutex> lg(m);
+                    hits += filter.contains(key);
+                } else {
+                    hits += filter.contains(key);
+                }
+            } else if (churn) {
+                unique_lock<mutex> lg(m, defer_lock);
+                if (lock_writes) lg.lock();
+                if (churn_live) {
+                    filter.erase(churn_key);
+                } else {
+                    churn_key = rng.next();
+                    filter.insert(churn_key);
+                }
+                churn_live = !churn_live;
             } else {
                 uint64_t key = pos[(start_op + local_insert_count) % pos_sz];
                 local_insert_count++;
@@ -1138,10 +6109,14 @@ double run_threaded_throughput(ApproxFilter &filter,
                 } else if (dynamic) {
                     filter.insert(key);
                 } else {
-                    (void)filter.contains(key);
+                    hits += filter.contains(key);
                 }
             }
         }
+        volatile size_t sink = hits;
+        (void)sink;
+        thread_secs[tid] = duration_cast<nanoseconds>(
+            high_resolution_clock::now() - w0).count() * 1e-9;
     };
 
     auto t0 = high_resolution_clock::now();
@@ -1159,16 +6134,87 @@ double run_threaded_throughput(ApproxFilter &filter,
     for (auto &th : ts) th.join();
     auto t1 = high_resolution_clock::now();
 
-    double elapsed_ns = duration_cast<nanoseconds>(t1 - t0).count();
-    double seconds = elapsed_ns * 1e-9;
-    return (double)total_ops / seconds;
+    if (per_thread_ops_per_sec) {
+        for (int tid = 0; tid < threads; ++tid) {
+            size_t ops_this = per + (tid < (int)rem ? 1 : 0);
+            per_thread_ops_per_sec->push_back(
+                thread_secs[tid] > 0 ? (double)ops_this / thread_secs[tid] : 0.0);
+        }
+    }
+
+    double elapsed_ns = duration_cast<nanoseconds>(t1 - t0).count();
+    double seconds = elapsed_ns * 1e-9;
+    return (double)total_ops / seconds;
+}
+
+// Replays a recorded op stream instead: thread t takes ops t, t + threads,
+// ..., so the threads advance through the stream together.
+template<typename F>
+double run_threaded_throughput(F &filter,
+                               const vector<Op> &ops,
+                               int threads,
+                               bool dynamic,
+                               bool lock_writes)
+{
+    using namespace std::chrono;
+    mutex m;
+
+    auto worker = [&](int tid) {
+        size_t hits = 0;
+        for (size_t i = (size_t)tid; i < ops.size(); i += (size_t)threads) {
+            const Op &op = ops[i];
+            if (op.type == 0 || !dynamic) {
+                hits += filter.contains(op.key);
+                continue;
+            }
+            unique_lock<mutex> lg(m, defer_lock);
+            if (lock_writes) lg.lock();
+            if (op.type == 1) {
+                filter.insert(op.key);
+            } else {
+                filter.erase(op.key);
+            }
+        }
+        volatile size_t sink = hits;
+        (void)sink;
+    };
+
+    auto t0 = high_resolution_clock::now();
+    parallel_run(threads, worker);
+    auto t1 = high_resolution_clock::now();
+    double seconds = duration_cast<nanoseconds>(t1 - t0).count() * 1e-9;
+    return (double)ops.size() / seconds;
 }
 
 // ------------------- Thread Scaling Experiment -------------------
 
 void run_thread_scaling() {
     cout << "filter,n,target_fpr,workload,neg_share,threads,"
-            "ops,ops_per_sec_mean,ops_per_sec_std\n";
+            "ops,ops_per_sec_mean,ops_per_sec_std,"
+         << PerfCounters::csv_header() << ","
+         << "placement,cpus,"
+            "per_thread_ops_per_sec_mean,per_thread_ops_per_sec_min\n";
+
+    // read scaling sweeps every placement unless one is given; the write
+    // contention runs below use --placement (default: the OS decides)
+    vector<PlacementSpec> placements;
+    if (g_placement_set) {
+        placements.push_back(g_placement);
+    } else {
+        for (auto kind : {Placement::NONE, Placement::COMPACT,
+                          Placement::SCATTER, Placement::SMT_FIRST}) {
+            PlacementSpec p;
+            p.kind = kind;
+            placements.push_back(p);
+        }
+    }
+    auto write_placement = [&](const PlacementSpec &pl, int tcount,
+                               const vector<double> &per_thread) {
+        cout << "," << placement_str(pl) << ","
+             << placement_cpus_str(pl, tcount) << ","
+             << mean_vec(per_thread) << ","
+             << *min_element(per_thread.begin(), per_thread.end()) << "\n";
+    };
 
     size_t n = 1000000;
     vector<double> target_fprs = {0.01};
@@ -1188,12 +6234,15 @@ void run_thread_scaling() {
         BlockedBloomFilter bloom(n, target_fpr);
         for (auto k : pos) bloom.insert(k);
 
-        CuckooFilter cf(n, target_fpr, 4, 8);
+        CuckooFilter cf(n, target_fpr, 8);
         for (auto k : pos) cf.insert(k);
 
         QuotientFilter qf(n, target_fpr, 8);
         for (auto k : pos) qf.insert(k);
 
+        RankSelectQuotientFilter rq(n, target_fpr, 8);
+        for (auto k : pos) rq.insert(k);
+
         XORFilter xf(n, target_fpr, 8);
         bool ok = xf.build(pos);
 
@@ -1201,6 +6250,7 @@ void run_thread_scaling() {
         filters.push_back({FilterType::BLOOM_BLOCKED, &bloom});
         filters.push_back({FilterType::CUCKOO, &cf});
         filters.push_back({FilterType::QUOTIENT, &qf});
+        filters.push_back({FilterType::RSQF, &rq});
         if (ok) filters.push_back({FilterType::XOR_FILTER, &xf});
 
         for (auto [ft, fptr] : filters) {
@@ -1208,33 +6258,138 @@ void run_thread_scaling() {
                 bool dynamic =
                     (ft == FilterType::CUCKOO ||
                      ft == FilterType::QUOTIENT ||
+                     ft == FilterType::RSQF ||
                      ft == FilterType::BLOOM_BLOCKED);
                 bool lock_writes = dynamic && (wt != WorkloadType::READ_ONLY);
 
-                for (int tcount : thread_counts) {
-                    vector<double> opsps;
+                for (auto &pl : placements) {
+                    for (int tcount : thread_counts) {
+                        vector<double> opsps, per_thread;
+                        PerfCounters pc(g_perf);
+                        for (int trial = 0; trial < g_trials; ++trial) {
+                            double ops_per_sec = pc.measure([&] {
+                                return dispatch_filter(ft, *fptr, [&](auto &f) {
+                                    return run_threaded_throughput(
+                                        f, wt, neg_share,
+                                        pos, neg,
+                                        tcount, total_ops,
+                                        dynamic, lock_writes,
+                                        false, false, pl, &per_thread
+                                    );
+                                });
+                            });
+                            opsps.push_back(ops_per_sec);
+                        }
+                        double ops_mean = mean_vec(opsps);
+                        double ops_std  = stddev_vec(opsps);
+
+                        cout << filter_type_str(ft) << ","
+                             << n << ","
+                             << target_fpr << ","
+                             << workload_type_str(wt) << ","
+                             << neg_share << ","
+                             << tcount << ","
+                             << total_ops << ","
+                             << ops_mean << ","
+                             << ops_std << ",";
+                        pc.write_csv(cout, (double)total_ops * g_trials);
+                        write_placement(pl, tcount, per_thread);
+                    }
+                }
+            }
+        }
+
+        // Bloom inserts behind the shared write mutex vs. lock-free
+        // fetch_or, on the same ConcurrentBloomFilter so only the write
+        // path differs. Each point starts from a fresh filter holding half
+        // of the keys, so the write share still sets new bits.
+        vector<WorkloadType> write_workloads = {
+            WorkloadType::READ_MOSTLY,
+            WorkloadType::BALANCED
+        };
+        vector<int> write_thread_counts = {1, 2, 4, 8, 16};
+
+        for (bool atomic_or : {false, true}) {
+            for (auto wt : write_workloads) {
+                for (int tcount : write_thread_counts) {
+                    ConcurrentBloomFilter bf(n, target_fpr);
+                    for (size_t i = 0; i < n / 2; ++i) bf.insert(pos[i]);
+
+                    vector<double> opsps, per_thread;
+                    PerfCounters pc(g_perf);
                     for (int trial = 0; trial < g_trials; ++trial) {
-                        double ops_per_sec = run_threaded_throughput(
-                            *fptr, wt, neg_share,
-                            pos, neg,
-                            tcount, total_ops,
-                            dynamic, lock_writes
-                        );
-                        opsps.push_back(ops_per_sec);
+                        opsps.push_back(pc.measure([&] {
+                            return run_threaded_throughput(
+                                bf, wt, neg_share,
+                                pos, neg,
+                                tcount, total_ops,
+                                true, !atomic_or,
+                                false, false, g_placement, &per_thread
+                            );
+                        }));
                     }
-                    double ops_mean = mean_vec(opsps);
-                    double ops_std  = stddev_vec(opsps);
 
-                    cout << filter_type_str(ft) << ","
+                    cout << (atomic_or
+                                 ? filter_type_str(FilterType::BLOOM_CONCURRENT)
+                                 : string("bloom_mutex")) << ","
                          << n << ","
                          << target_fpr << ","
                          << workload_type_str(wt) << ","
                          << neg_share << ","
                          << tcount << ","
                          << total_ops << ","
-                         << ops_mean << ","
-                         << ops_std
-                         << "\n";
+                         << mean_vec(opsps) << ","
+                         << stddev_vec(opsps) << ",";
+                    pc.write_csv(cout, (double)total_ops * g_trials);
+                    write_placement(g_placement, tcount, per_thread);
+                }
+            }
+        }
+
+        // Cuckoo under real writes: one mutex around every op vs. striped
+        // locks with optimistic reads. Both are filled to the same load and
+        // then churned with insert/erase pairs.
+        CuckooFilter cf_locked(n, target_fpr, 8);
+        for (auto k : pos) cf_locked.insert(k);
+        ConcurrentCuckooFilter ccf(n, target_fpr, 8);
+        for (auto k : pos) ccf.insert(k);
+
+        vector<pair<FilterType, ApproxFilter*>> cuckoos = {
+            {FilterType::CUCKOO, &cf_locked},
+            {FilterType::CUCKOO_CONCURRENT, &ccf}
+        };
+        for (auto [ft, fptr] : cuckoos) {
+            bool global = (ft == FilterType::CUCKOO);
+            for (auto wt : write_workloads) {
+                for (int tcount : write_thread_counts) {
+                    vector<double> opsps, per_thread;
+                    PerfCounters pc(g_perf);
+                    for (int trial = 0; trial < g_trials; ++trial) {
+                        opsps.push_back(pc.measure([&] {
+                            return dispatch_filter(ft, *fptr, [&](auto &f) {
+                                return run_threaded_throughput(
+                                    f, wt, neg_share,
+                                    pos, neg,
+                                    tcount, total_ops,
+                                    true, global, global, true,
+                                    g_placement, &per_thread
+                                );
+                            });
+                        }));
+                    }
+
+                    cout << (global ? string("cuckoo_global_lock")
+                                    : filter_type_str(ft)) << ","
+                         << n << ","
+                         << target_fpr << ","
+                         << workload_type_str(wt) << ","
+                         << neg_share << ","
+                         << tcount << ","
+                         << total_ops << ","
+                         << mean_vec(opsps) << ","
+                         << stddev_vec(opsps) << ",";
+                    pc.write_csv(cout, (double)total_ops * g_trials);
+                    write_placement(g_placement, tcount, per_thread);
                 }
             }
         }
@@ -1243,11 +6398,76 @@ void run_thread_scaling() {
 
 // ------------------- Space vs Accuracy -------------------
 
+template<typename F>
+double time_ms(F &&fn) {
+    using namespace std::chrono;
+    auto t0 = high_resolution_clock::now();
+    fn();
+    auto t1 = high_resolution_clock::now();
+    return duration_cast<nanoseconds>(t1 - t0).count() * 1e-6;
+}
+
+// FPR over neg; query_mops gets the rate of those (negative) lookups.
+template<typename F>
+double timed_fpr(const F &f, const vector<uint64_t> &neg, double &query_mops) {
+    size_t fp = 0;
+    double ms = time_ms([&] {
+        for (auto k : neg) if (f.contains(k)) fp++;
+    });
+    query_mops = (double)neg.size() / (ms * 1e3);
+    return (double)fp / (double)neg.size();
+}
+
+template<typename Fuse>
+void space_row_fuse(const string &name, size_t n, double target_fpr,
+                    const vector<uint64_t> &pos, const vector<uint64_t> &neg)
+{
+    Fuse ff(n, 11, fuse_shards_for(n, g_build_threads));
+    bool ok = false;
+    double build_ms = time_ms([&] { ok = ff.build(pos, g_build_threads); });
+    double achieved = 1.0, qmops = 0.0;
+    if (ok) achieved = timed_fpr(ff, neg, qmops);
+    cout << name << "," << n << "," << target_fpr << ","
+         << achieved << "," << bits_per_entry(ff, n) << ","
+         << build_ms << "," << qmops << "\n";
+}
+
+template<typename Ribbon>
+void space_row_ribbon(const string &name, size_t n, double target_fpr,
+                      const vector<uint64_t> &pos, const vector<uint64_t> &neg)
+{
+    Ribbon rf(n, target_fpr);
+    bool ok = false;
+    double build_ms = time_ms([&] { ok = rf.build(pos); });
+    double achieved = 1.0, qmops = 0.0;
+    if (ok) achieved = timed_fpr(rf, neg, qmops);
+    cout << name << "," << n << "," << target_fpr << ","
+         << achieved << "," << bits_per_entry(rf, n) << ","
+         << build_ms << "," << qmops << "\n";
+}
+
+// Calls fn(integral_constant<unsigned, W>) for the narrowest instantiated
+// fingerprint width W >= bits. 15 is skipped: a packed 4-slot cuckoo
+// bucket must fit 56 bits.
+template<typename Fn>
+void with_fp_width(int bits, Fn &&fn) {
+    if (bits <= 6)  return fn(integral_constant<unsigned, 6>());
+    if (bits <= 7)  return fn(integral_constant<unsigned, 7>());
+    if (bits <= 8)  return fn(integral_constant<unsigned, 8>());
+    if (bits <= 9)  return fn(integral_constant<unsigned, 9>());
+    if (bits <= 10) return fn(integral_constant<unsigned, 10>());
+    if (bits <= 11) return fn(integral_constant<unsigned, 11>());
+    if (bits <= 12) return fn(integral_constant<unsigned, 12>());
+    if (bits <= 13) return fn(integral_constant<unsigned, 13>());
+    if (bits <= 14) return fn(integral_constant<unsigned, 14>());
+    return fn(integral_constant<unsigned, 16>());
+}
+
 void run_space_accuracy_sweep() {
     vector<size_t> Ns = {1'000'000, 5'000'000, 10'000'000};
     vector<double> target_fprs = {0.05, 0.01, 0.001};
 
-    cout << "filter,n,target_fpr,achieved_fpr,bpe\n";
+    cout << "filter,n,target_fpr,achieved_fpr,bpe,build_ms,query_mops\n";
 
     // Deterministic RNG so runs are reproducible
     SplitMix64 rng(123456789ULL);
@@ -1261,59 +6481,1119 @@ void run_space_accuracy_sweep() {
             // Bloom
             {
                 BlockedBloomFilter bloom(n, target_fpr);
-                for (auto k : pos) bloom.insert(k);
-                size_t fp = 0;
-                for (auto k : neg) if (bloom.contains(k)) fp++;
-                double achieved = (double)fp / (double)n;
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) bloom.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(bloom, neg, qmops);
                 double bpe = bits_per_entry(bloom, n);
                 cout << "bloom_blocked," << n << "," << target_fpr << ","
-                     << achieved << "," << bpe << "\n";
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
+            }
+            // Split-block Bloom, 32-byte and 64-byte buckets
+            {
+                SplitBlockBloomFilter<8> sb(n, target_fpr);
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) sb.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(sb, neg, qmops);
+                double bpe = bits_per_entry(sb, n);
+                cout << "bloom_split32," << n << "," << target_fpr << ","
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
+            }
+            {
+                SplitBlockBloomFilter<16> sb(n, target_fpr);
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) sb.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(sb, neg, qmops);
+                double bpe = bits_per_entry(sb, n);
+                cout << "bloom_split64," << n << "," << target_fpr << ","
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
             }
             // Cuckoo
             {
-                CuckooFilter cf(n, target_fpr, 4, 8);
-                for (auto k : pos) cf.insert(k);
-                size_t fp = 0;
-                for (auto k : neg) if (cf.contains(k)) fp++;
-                double achieved = (double)fp / (double)n;
+                CuckooFilter cf(n, target_fpr, 8);
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) cf.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(cf, neg, qmops);
                 double bpe = bits_per_entry(cf, n);
                 cout << "cuckoo," << n << "," << target_fpr << ","
-                     << achieved << "," << bpe << "\n";
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
             }
             // Quotient
             {
                 QuotientFilter qf(n, target_fpr, 8);
-                for (auto k : pos) qf.insert(k);
-                size_t fp = 0;
-                for (auto k : neg) if (qf.contains(k)) fp++;
-                double achieved = (double)fp / (double)n;
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) qf.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(qf, neg, qmops);
                 double bpe = bits_per_entry(qf, n);
                 cout << "quotient," << n << "," << target_fpr << ","
-                     << achieved << "," << bpe << "\n";
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
+            }
+            // Rank-select quotient
+            {
+                RankSelectQuotientFilter rq(n, target_fpr, 8);
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) rq.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(rq, neg, qmops);
+                double bpe = bits_per_entry(rq, n);
+                cout << "rsqf," << n << "," << target_fpr << ","
+                     << achieved << "," << bpe << ","
+                     << build_ms << "," << qmops << "\n";
             }
             // XOR
             {
                 XORFilter xf(n, target_fpr, 8);
-                bool ok = xf.build(pos);
+                bool ok = false;
+                double build_ms = time_ms([&] { ok = xf.build(pos); });
                 if (!ok) {
                     double bpe = bits_per_entry(xf, n);
                     cout << "xor," << n << "," << target_fpr << ","
-                         << 1.0 << "," << bpe << "\n";
+                         << 1.0 << "," << bpe << ","
+                         << build_ms << "," << 0.0 << "\n";
                 } else {
-                    size_t fp = 0;
-                    for (auto k : neg) if (xf.contains(k)) fp++;
-                    double achieved = (double)fp / (double)n;
+                    double qmops = 0.0;
+                    double achieved = timed_fpr(xf, neg, qmops);
                     double bpe = bits_per_entry(xf, n);
                     cout << "xor," << n << "," << target_fpr << ","
-                         << achieved << "," << bpe << "\n";
+                         << achieved << "," << bpe << ","
+                         << build_ms << "," << qmops << "\n";
+                }
+            }
+            // Cuckoo and XOR with slots exactly as wide as the target needs
+            // (bit-packed unless 8 bits), instead of 16 bits regardless
+            int cuckoo_bits = (int)ceil(
+                log2(2.0 * CuckooFilter::bucket_size / target_fpr));
+            with_fp_width(cuckoo_bits, [&](auto w) {
+                constexpr unsigned W = decltype(w)::value;
+                BasicCuckooFilter<4, W> cf(n, target_fpr, W);
+                double build_ms = time_ms([&] {
+                    for (auto k : pos) cf.insert(k);
+                });
+                double qmops = 0.0;
+                double achieved = timed_fpr(cf, neg, qmops);
+                cout << "cuckoo_w" << W << "," << n << "," << target_fpr << ","
+                     << achieved << "," << bits_per_entry(cf, n)
+                     << "," << build_ms << "," << qmops << "\n";
+            });
+            with_fp_width((int)ceil(-log2(target_fpr)), [&](auto w) {
+                constexpr unsigned W = decltype(w)::value;
+                BasicXorFilter<W> xf(n, target_fpr, W);
+                bool ok = false;
+                double build_ms = time_ms([&] { ok = xf.build(pos); });
+                double achieved = 1.0, qmops = 0.0;
+                if (ok) achieved = timed_fpr(xf, neg, qmops);
+                cout << "xor_w" << W << "," << n << "," << target_fpr << ","
+                     << achieved << "," << bits_per_entry(xf, n) << ","
+                     << build_ms << "," << qmops << "\n";
+            });
+            // Binary fuse: smallest fingerprint that meets the target
+            if (target_fpr >= 1.0 / 256.0) {
+                space_row_fuse<BinaryFuseFilter<uint8_t, 3>>(
+                    "fuse3_8", n, target_fpr, pos, neg);
+                space_row_fuse<BinaryFuseFilter<uint8_t, 4>>(
+                    "fuse4_8", n, target_fpr, pos, neg);
+            } else {
+                space_row_fuse<BinaryFuseFilter<uint16_t, 3>>(
+                    "fuse3_16", n, target_fpr, pos, neg);
+                space_row_fuse<BinaryFuseFilter<uint16_t, 4>>(
+                    "fuse4_16", n, target_fpr, pos, neg);
+            }
+            // Ribbon: fractional result bits, so no rounding to a width
+            space_row_ribbon<RibbonFilter64>("ribbon64", n, target_fpr,
+                                             pos, neg);
+            space_row_ribbon<RibbonFilter128>("ribbon128", n, target_fpr,
+                                              pos, neg);
+        }
+    }
+}
+
+
+
+
+// ------------------- Static Filter Build Scaling -------------------
+
+template<typename Fuse>
+void build_rows_fuse(const string &name, size_t n,
+                     const vector<uint64_t> &pos, const vector<uint64_t> &neg,
+                     const vector<int> &thread_counts, size_t shards)
+{
+    for (int threads : thread_counts) {
+        vector<double> ms;
+        BuildStats last;
+        double fpr = 1.0, bpe = 0.0;
+        for (int t = 0; t < g_trials; ++t) {
+            Fuse ff(n, 11, shards);
+            if (!ff.build(pos, threads)) break;
+            ms.push_back(ff.last_build.build_ms);
+            last = ff.last_build;
+            fpr = measure_fpr(ff, neg);
+            bpe = bits_per_entry(ff, n);
+        }
+        cout << name << "," << n << "," << threads << "," << shards << ","
+             << mean_vec(ms) << "," << stddev_vec(ms) << ","
+             << last.peak_bytes / 1e6 << "," << bpe << "," << fpr << "\n";
+    }
+}
+
+void run_build_scaling() {
+    cout << "filter,n,threads,shards,build_ms_mean,build_ms_std,"
+            "peak_mb,bpe,achieved_fpr\n";
+
+    vector<size_t> Ns = {1'000'000, 10'000'000};
+    vector<int> thread_counts = {1, 2, 4, 8, 16};
+    int max_threads = thread_counts.back();
+
+    for (size_t n : Ns) {
+        auto pos = make_keys(n, 777);
+        auto neg = make_keys(n / 10, 778);
+
+        {
+            vector<double> ms;
+            BuildStats last;
+            double fpr = 1.0, bpe = 0.0;
+            for (int t = 0; t < g_trials; ++t) {
+                XORFilter xf(n, 0.01, 8);
+                if (!xf.build(pos)) break;
+                ms.push_back(xf.last_build.build_ms);
+                last = xf.last_build;
+                fpr = measure_fpr(xf, neg);
+                bpe = bits_per_entry(xf, n);
+            }
+            cout << "xor," << n << ",1,1,"
+                 << mean_vec(ms) << "," << stddev_vec(ms) << ","
+                 << last.peak_bytes / 1e6 << "," << bpe << "," << fpr << "\n";
+        }
+
+        // unsharded single-threaded baseline, then one fixed sharded layout
+        // built with increasing thread counts
+        size_t shards = fuse_shards_for(n, max_threads);
+        build_rows_fuse<BinaryFuseFilter<uint8_t, 3>>(
+            "fuse3_8", n, pos, neg, {1}, 1);
+        build_rows_fuse<BinaryFuseFilter<uint8_t, 3>>(
+            "fuse3_8", n, pos, neg, thread_counts, shards);
+        build_rows_fuse<BinaryFuseFilter<uint8_t, 4>>(
+            "fuse4_8", n, pos, neg, {1}, 1);
+        build_rows_fuse<BinaryFuseFilter<uint8_t, 4>>(
+            "fuse4_8", n, pos, neg, thread_counts, shards);
+    }
+}
+
+// ------------------- Batched Lookup Pipelining -------------------
+
+// Amortized ns/op of run_workload's batched mode vs. group size; group 0 is
+// the plain one-contains()-at-a-time loop. Each point gets a freshly built
+// filter so the inserts of earlier points don't skew its load.
+void run_batch_sweep() {
+    cout << "filter,n,target_fpr,workload,neg_share,group,ops,"
+            "ns_per_op_mean,ns_per_op_std,ops_per_sec_mean,p99_ns_mean\n";
+
+    vector<size_t> Ns = {1'000'000, 8'000'000};
+    vector<size_t> groups = {0, 1, 4, 8, 16, 32, 64};
+    if (g_batch > 0) groups = {0, g_batch};
+    vector<WorkloadType> workloads = {
+        WorkloadType::READ_ONLY,
+        WorkloadType::READ_MOSTLY
+    };
+    double target_fpr = 0.01;
+    double neg_share = 0.5;
+
+    for (size_t n : Ns) {
+        auto pos = make_keys(n, 9001);
+        auto neg = make_keys(n, 9002);
+
+        auto sweep = [&](FilterType ft, auto make) {
+            for (auto wt : workloads) {
+                auto ops = make_workload(2000000, wt, neg_share, pos, neg);
+                for (size_t group : groups) {
+                    vector<double> ns, opsps, p99s;
+                    for (int t = 0; t < g_trials; ++t) {
+                        auto f = make();
+                        RunResult rr = run_workload(*f, ops, true, group);
+                        ns.push_back(rr.ns_per_op);
+                        opsps.push_back(rr.ops_per_sec);
+                        p99s.push_back(rr.p99_ns);
+                    }
+                    cout << filter_type_str(ft) << ","
+                         << n << ","
+                         << target_fpr << ","
+                         << workload_type_str(wt) << ","
+                         << neg_share << ","
+                         << group << ","
+                         << ops.size() << ","
+                         << mean_vec(ns) << ","
+                         << stddev_vec(ns) << ","
+                         << mean_vec(opsps) << ","
+                         << mean_vec(p99s)
+                         << "\n";
+                }
+            }
+        };
+
+        sweep(FilterType::BLOOM_BLOCKED, [&]() {
+            auto f = make_unique<BlockedBloomFilter>(n, target_fpr);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        sweep(FilterType::CUCKOO, [&]() {
+            auto f = make_unique<CuckooFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        sweep(FilterType::QUOTIENT, [&]() {
+            auto f = make_unique<QuotientFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+    }
+}
+
+// ------------------- Persistence: Open-to-First-Query -------------------
+
+// Evicts the file from the page cache; returns the fraction of its pages
+// still resident afterwards (tmpfs, for one, cannot drop them).
+double drop_page_cache(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return 1.0;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    struct stat st;
+    double resident = 1.0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_t len = (size_t)st.st_size;
+        void* addr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            size_t pages = (len + FILTER_PAGE - 1) / FILTER_PAGE;
+            vector<unsigned char> vec(pages);
+            if (mincore(addr, len, vec.data()) == 0) {
+                size_t in = 0;
+                for (auto v : vec) in += v & 1;
+                resident = (double)in / (double)pages;
+            }
+            munmap(addr, len);
+        }
+    }
+    close(fd);
+    return resident;
+}
+
+// One CSV row: rebuild-from-keys time vs. mapping a saved image, cold
+// (page cache dropped first) and warm, each up to the first answered query.
+template<typename F, typename Build>
+void persist_row(const string &name, size_t n, const vector<uint64_t> &pos,
+                 Build &&build)
+{
+    unique_ptr<F> f;
+    double rebuild_ms = time_ms([&]() { f = build(); });
+    if (!f) {
+        cerr << name << ": build failed at n=" << n << "\n";
+        return;
+    }
+    string path = g_persist_dir + "/amf_" + name + "_" + to_string(n) + ".bin";
+    double save_ms = time_ms([&]() { f->save(path); });
+    f.reset();
+
+    struct stat st;
+    double file_mb = (stat(path.c_str(), &st) == 0) ? st.st_size / 1e6 : 0.0;
+    uint64_t probe = pos[n / 2];
+
+    vector<double> cold_us, warm_us, resident;
+    bool all_hit = true;
+    auto open_and_query = [&]() {
+        unique_ptr<F> g;
+        bool hit = false;
+        double us = time_ms([&]() {
+            g = load_mmap<F>(path);
+            hit = g && g->contains(probe);
+        }) * 1e3;
+        all_hit = all_hit && hit;
+        return us;
+    };
+    for (int t = 0; t < g_trials; ++t) {
+        resident.push_back(drop_page_cache(path));
+        cold_us.push_back(open_and_query());
+        warm_us.push_back(open_and_query());
+    }
+    remove(path.c_str());
+
+    cout << name << "," << n << "," << file_mb << ","
+         << rebuild_ms << "," << save_ms << ","
+         << mean_vec(cold_us) << "," << stddev_vec(cold_us) << ","
+         << mean_vec(warm_us) << "," << stddev_vec(warm_us) << ","
+         << mean_vec(resident) << "," << all_hit << "\n";
+}
+
+void run_persist_bench() {
+    cout << "filter,n,file_mb,rebuild_ms,save_ms,"
+            "cold_open_us_mean,cold_open_us_std,"
+            "warm_open_us_mean,warm_open_us_std,"
+            "cold_resident_frac,first_query_hit\n";
+
+    vector<size_t> Ns = {1'000'000, 10'000'000};
+    double target_fpr = 0.01;
+
+    for (size_t n : Ns) {
+        auto pos = make_keys(n, 31337);
+
+        persist_row<BlockedBloomFilter>("bloom_blocked", n, pos, [&]() {
+            auto f = make_unique<BlockedBloomFilter>(n, target_fpr);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        persist_row<CuckooFilter>("cuckoo", n, pos, [&]() {
+            auto f = make_unique<CuckooFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        persist_row<QuotientFilter>("quotient", n, pos, [&]() {
+            auto f = make_unique<QuotientFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        persist_row<RankSelectQuotientFilter>("rsqf", n, pos, [&]() {
+            auto f = make_unique<RankSelectQuotientFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        });
+        persist_row<XORFilter>("xor", n, pos, [&]() {
+            auto f = make_unique<XORFilter>(n, target_fpr, 8);
+            if (!f->build(pos)) f.reset();
+            return f;
+        });
+        persist_row<BinaryFuseFilter<uint8_t, 3>>("fuse3_8", n, pos, [&]() {
+            auto f = make_unique<BinaryFuseFilter<uint8_t, 3>>(
+                n, 11, fuse_shards_for(n, g_build_threads));
+            if (!f->build(pos, g_build_threads)) f.reset();
+            return f;
+        });
+    }
+}
+
+// ------------------- Skewed Key Distributions -------------------
+
+// Lookup cost under the skewed access patterns of real traffic: hot keys
+// (and hot negatives) stay cached, so skew flatters every filter but not
+// by the same amount.
+void run_skew_sweep() {
+    cout << "filter,n,target_fpr,dist,workload,neg_share,ops,"
+            "ops_per_sec_mean,ops_per_sec_std,p50_ns_mean,p99_ns_mean,"
+            "batch_ops_per_sec_mean\n";
+
+    size_t n = 1000000;
+    double target_fpr = 0.01;
+    double neg_share = 0.5;
+    vector<KeyDistSpec> dists(6);
+    dists[1].kind = KeyDist::ZIPF;
+    dists[1].theta = 0.99;
+    dists[2].kind = KeyDist::ZIPF;
+    dists[2].theta = 1.2;
+    dists[3].kind = KeyDist::HOTSPOT;
+    dists[4].kind = KeyDist::WINDOW;
+    dists[5].kind = KeyDist::WINDOW;
+    dists[5].window = 0.0001;
+
+    auto pos = make_keys(n, 123);
+    auto neg = make_keys(n, 456);
+
+    BlockedBloomFilter bloom(n, target_fpr);
+    CuckooFilter cf(n, target_fpr, 8);
+    QuotientFilter qf(n, target_fpr, 8);
+    RankSelectQuotientFilter rq(n, target_fpr, 8);
+    for (auto k : pos) {
+        bloom.insert(k); cf.insert(k); qf.insert(k); rq.insert(k);
+    }
+    XORFilter xf(n, target_fpr, 8);
+    bool ok = xf.build(pos);
+
+    vector<pair<FilterType, ApproxFilter*>> filters;
+    filters.push_back({FilterType::BLOOM_BLOCKED, &bloom});
+    filters.push_back({FilterType::CUCKOO, &cf});
+    filters.push_back({FilterType::QUOTIENT, &qf});
+    filters.push_back({FilterType::RSQF, &rq});
+    if (ok) filters.push_back({FilterType::XOR_FILTER, &xf});
+
+    for (const auto &dist : dists) {
+        auto ops = make_workload(2000000, WorkloadType::READ_ONLY, neg_share,
+                                 pos, neg, dist);
+        for (auto [ft, fptr] : filters) {
+            vector<double> opsps, p50s, p99s, batch_ps;
+            for (int t = 0; t < g_trials; ++t) {
+                RunResult rr = dispatch_filter(ft, *fptr, [&](auto &f) {
+                    return run_workload(f, ops, false);
+                });
+                opsps.push_back(rr.ops_per_sec);
+                p50s.push_back(rr.p50_ns);
+                p99s.push_back(rr.p99_ns);
+                batch_ps.push_back(dispatch_filter(ft, *fptr, [&](auto &f) {
+                    return run_lookup_batched(f, ops);
+                }));
+            }
+            cout << filter_type_str(ft) << ","
+                 << n << ","
+                 << target_fpr << ","
+                 << key_dist_str(dist) << ","
+                 << "read_only" << ","
+                 << neg_share << ","
+                 << ops.size() << ","
+                 << mean_vec(opsps) << ","
+                 << stddev_vec(opsps) << ","
+                 << mean_vec(p50s) << ","
+                 << mean_vec(p99s) << ","
+                 << mean_vec(batch_ps)
+                 << "\n";
+        }
+    }
+}
+
+// ------------------- Trace Replay -------------------
+
+// Replays --trace=PATH through run_workload (one thread, with latency) and
+// the threaded harness. Without --trace, a Zipf read-mostly trace is
+// recorded under --dir first, so the round trip itself gets exercised.
+void run_trace_replay() {
+    Trace tr;
+    string path = g_trace_path;
+    if (path.empty()) {
+        path = g_persist_dir + "/amf_trace_zipf.bin";
+        size_t n = 1000000;
+        KeyDistSpec zipf;
+        zipf.kind = KeyDist::ZIPF;
+        tr.preload = make_keys(n, 123);
+        auto neg = make_keys(n, 456);
+        auto fresh = make_keys(n, 789);
+        tr.ops = make_workload(2000000, WorkloadType::READ_MOSTLY, 0.5,
+                               tr.preload, neg, zipf);
+        // an insert brings in a new key rather than re-adding a hot one
+        size_t next = 0;
+        for (auto &op : tr.ops) {
+            if (op.type == 1) op.key = fresh[next++ % n];
+        }
+        if (!write_trace(path, tr)) {
+            cerr << "cannot write trace " << path << "\n";
+            return;
+        }
+        tr = Trace();
+    }
+    if (!read_trace(path, tr)) {
+        cerr << "cannot read trace " << path << "\n";
+        return;
+    }
+
+    cout << "filter,trace,preload,ops,writes,harness,threads,"
+            "ops_per_sec_mean,ops_per_sec_std,p50_ns_mean,p99_ns_mean\n";
+
+    size_t n = max<size_t>(1, tr.preload.size());
+    size_t writes = tr.writes();
+    double target_fpr = 0.01;
+    vector<int> thread_counts = {1, 2, 4};
+    string name = path.substr(path.find_last_of('/') + 1);
+
+    // every run starts from a filter freshly built from the preload (and
+    // sized for it plus every insert in the trace), so writes from one run
+    // don't leak into the next
+    auto replay = [&](FilterType ft, auto make, bool dynamic) {
+        vector<double> opsps, p50s, p99s;
+        for (int t = 0; t < g_trials; ++t) {
+            auto f = make();
+            if (!f) return;
+            RunResult rr = run_workload(*f, tr.ops, dynamic);
+            opsps.push_back(rr.ops_per_sec);
+            p50s.push_back(rr.p50_ns);
+            p99s.push_back(rr.p99_ns);
+        }
+        cout << filter_type_str(ft) << "," << name << ","
+             << tr.preload.size() << "," << tr.ops.size() << ","
+             << writes << ",run_workload,1,"
+             << mean_vec(opsps) << "," << stddev_vec(opsps) << ","
+             << mean_vec(p50s) << "," << mean_vec(p99s) << "\n";
+
+        for (int tcount : thread_counts) {
+            opsps.clear();
+            for (int t = 0; t < g_trials; ++t) {
+                auto f = make();
+                opsps.push_back(run_threaded_throughput(
+                    *f, tr.ops, tcount, dynamic, dynamic && writes > 0));
+            }
+            cout << filter_type_str(ft) << "," << name << ","
+                 << tr.preload.size() << "," << tr.ops.size() << ","
+                 << writes << ",threaded," << tcount << ","
+                 << mean_vec(opsps) << "," << stddev_vec(opsps) << ",0,0\n";
+        }
+    };
+
+    size_t cap = n + writes;
+    auto preloaded = [&](auto f) {
+        for (auto k : tr.preload) f->insert(k);
+        return f;
+    };
+    replay(FilterType::BLOOM_BLOCKED, [&] {
+        return preloaded(make_unique<BlockedBloomFilter>(cap, target_fpr));
+    }, true);
+    replay(FilterType::CUCKOO, [&] {
+        return preloaded(make_unique<CuckooFilter>(cap, target_fpr, 8));
+    }, true);
+    replay(FilterType::QUOTIENT, [&] {
+        return preloaded(make_unique<QuotientFilter>(cap, target_fpr, 8));
+    }, true);
+    replay(FilterType::RSQF, [&] {
+        return preloaded(
+            make_unique<RankSelectQuotientFilter>(cap, target_fpr, 8));
+    }, true);
+    replay(FilterType::XOR_FILTER, [&] {
+        auto f = make_unique<XORFilter>(n, target_fpr, 8);
+        if (!f->build(tr.preload)) f.reset();
+        return f;
+    }, false);
+}
+
+// ------------------- Open-Loop Latency Curves -------------------
+
+// Throughput/latency curves: for each filter, the rate the open-loop
+// clients sustain with no pacing at all sets the capacity, then offered
+// load is swept from 10% of it to past saturation with constant and
+// Poisson arrivals. Past saturation the queue (and so latency) grows for
+// as long as the run lasts, which is what a service sees; each point runs
+// for about POINT_SECONDS.
+void run_open_loop_sweep() {
+    cout << "filter,n,target_fpr,workload,arrival,clients,"
+            "offered_ops_per_sec,achieved_ops_per_sec,load_frac,"
+            "p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+
+    const double POINT_SECONDS = 0.1;
+    size_t n = 1000000;
+    double target_fpr = 0.01;
+    double neg_share = 0.5;
+    vector<double> load_fracs = {0.1, 0.25, 0.5, 0.7, 0.8, 0.9, 0.95,
+                                 1.0, 1.1, 1.25};
+    vector<WorkloadType> workloads = {
+        WorkloadType::READ_ONLY,
+        WorkloadType::READ_MOSTLY
+    };
+    int clients = max(1, g_clients);
+
+    auto pos = make_keys(n, 123);
+    auto neg = make_keys(n, 456);
+    auto fresh = make_keys(n, 789);
+
+    for (auto wt : workloads) {
+        auto all_ops = make_workload(4000000, wt, neg_share, pos, neg);
+        // inserts bring in new keys; filters get room for all of them
+        size_t inserts = 0;
+        for (auto &op : all_ops) {
+            if (op.type == 1) op.key = fresh[inserts++ % n];
+        }
+        size_t cap = n + min(inserts, n);
+
+        auto curve = [&](FilterType ft, auto make, bool dynamic) {
+            double peak;
+            {
+                auto f = make();
+                if (!f) return;
+                peak = run_open_loop(*f, all_ops, 1e15, clients, false,
+                                     dynamic, dynamic && clients > 1)
+                           .achieved_ops_per_sec;
+            }
+            for (bool poisson : {false, true}) {
+                for (double lf : load_fracs) {
+                    double rate = lf * peak;
+                    size_t count = min(all_ops.size(),
+                                       max<size_t>(100000,
+                                                   (size_t)(rate * POINT_SECONDS)));
+                    vector<Op> ops(all_ops.begin(), all_ops.begin() + count);
+                    auto f = make();
+                    OpenLoopResult r = run_open_loop(
+                        *f, ops, rate, clients, poisson, dynamic,
+                        dynamic && clients > 1);
+                    cout << filter_type_str(ft) << ","
+                         << n << ","
+                         << target_fpr << ","
+                         << workload_type_str(wt) << ","
+                         << (poisson ? "poisson" : "constant") << ","
+                         << clients << ","
+                         << r.offered_ops_per_sec << ","
+                         << r.achieved_ops_per_sec << ","
+                         << lf << ","
+                         << r.p50_ns << ","
+                         << r.p90_ns << ","
+                         << r.p99_ns << ","
+                         << r.p999_ns << ","
+                         << r.max_ns
+                         << "\n";
+                }
+            }
+        };
+
+        auto filled = [&](auto f) {
+            for (auto k : pos) f->insert(k);
+            return f;
+        };
+        curve(FilterType::BLOOM_BLOCKED, [&] {
+            return filled(make_unique<BlockedBloomFilter>(cap, target_fpr));
+        }, true);
+        curve(FilterType::CUCKOO, [&] {
+            return filled(make_unique<CuckooFilter>(cap, target_fpr, 8));
+        }, true);
+        curve(FilterType::QUOTIENT, [&] {
+            return filled(make_unique<QuotientFilter>(cap, target_fpr, 8));
+        }, true);
+        curve(FilterType::RSQF, [&] {
+            return filled(
+                make_unique<RankSelectQuotientFilter>(cap, target_fpr, 8));
+        }, true);
+        if (wt == WorkloadType::READ_ONLY) {
+            curve(FilterType::XOR_FILTER, [&] {
+                auto f = make_unique<XORFilter>(n, target_fpr, 8);
+                if (!f->build(pos)) f.reset();
+                return f;
+            }, false);
+        }
+    }
+}
+
+// ------------------- Adaptive Cuckoo: Repeated Negatives -------------------
+//
+// Negative lookups drawn from a fixed pool, Zipfian or uniform, as when
+// the same absent keys are asked for over and over. Every hit is a false
+// positive, and the adaptive filter is told so through
+// report_false_positive (standing in for the disk read that came back
+// empty). One row per window of the stream: cumulative false positives,
+// the window's FPR and its throughput including the reports. A final
+// lookup_only row per filter is the simple-sweep mix at 50% negatives.
+
+void run_adaptive_bench() {
+    using namespace std::chrono;
+    cout << "filter,neg_dist,phase,window,queries,cum_false_positives,"
+            "window_fpr,ops_per_sec\n";
+
+    size_t n = 1000000;
+    double target_fpr = 0.01;
+    size_t pool = 1000000;
+    size_t stream_ops = 10000000;
+    size_t windows = 10;
+    size_t per = stream_ops / windows;
+
+    auto pos = make_keys(n, 7001);
+    auto neg = make_keys(pool, 7002);
+
+    vector<KeyDistSpec> dists(2);
+    dists[0].kind = KeyDist::ZIPF;
+    dists[0].theta = 0.99;
+    dists[1].kind = KeyDist::UNIFORM;
+
+    for (const auto &dist : dists) {
+        KeyPicker pick(dist, pool, 7003);
+        vector<uint64_t> stream(stream_ops);
+        for (auto &k : stream) k = neg[pick.next()];
+
+        for (bool adaptive : {false, true}) {
+            string name = adaptive ? "cuckoo_adaptive" : "cuckoo";
+            CuckooFilter cf(n, target_fpr, 8, 3, 500, CuckooEviction::BFS,
+                            adaptive);
+            for (auto k : pos) cf.insert(k);
+
+            size_t cum_fp = 0;
+            for (size_t w = 0; w < windows; ++w) {
+                size_t fp = 0;
+                auto t0 = high_resolution_clock::now();
+                for (size_t i = w * per; i < (w + 1) * per; ++i) {
+                    if (cf.contains(stream[i])) {
+                        fp++;
+                        cf.report_false_positive(stream[i]);
+                    }
+                }
+                auto t1 = high_resolution_clock::now();
+                double sec = duration_cast<nanoseconds>(t1 - t0).count() * 1e-9;
+                cum_fp += fp;
+                cout << name << ","
+                     << key_dist_str(dist) << ","
+                     << "stream,"
+                     << w << ","
+                     << (w + 1) * per << ","
+                     << cum_fp << ","
+                     << (double)fp / (double)per << ","
+                     << (double)per / sec
+                     << "\n";
+            }
+
+            auto ops = make_workload(2000000, WorkloadType::READ_ONLY, 0.5,
+                                     pos, neg);
+            RunResult rr = run_workload(cf, ops, false);
+            cout << name << ","
+                 << key_dist_str(dist) << ","
+                 << "lookup_only,"
+                 << 0 << ","
+                 << ops.size() << ","
+                 << 0 << ","
+                 << 0.0 << ","
+                 << rr.ops_per_sec
+                 << "\n";
+        }
+    }
+}
+
+// ------------------- Range Filters: FPR / Throughput / Space -------------------
+//
+// Dyadic Bloom stacks of two heights against a prefix Bloom filter, on
+// keys drawn from a 2^32 universe (dense: ~4K apart at 1M keys) and from
+// the full 64-bit space. Each row is one range width, or log-uniform
+// widths for "mixed". Widths past a filter's limit (MAX_TOP_PROBES
+// top-level intervals), which it answers true by design, are left out:
+// mixed is capped there and larger fixed widths are skipped.
+// achieved_fpr is over the ranges known to be empty. A false negative is
+// a bug.
+
+void run_range_sweep() {
+    cout << "filter,n,key_bits,target_fpr,bpe,range_width,queries,"
+            "empty_queries,achieved_fpr,false_negatives,"
+            "ops_per_sec_mean,ops_per_sec_std,probes_per_query\n";
+
+    size_t n = 1000000;
+    double target_fpr = 0.01;
+    size_t n_queries = 200000;
+    vector<pair<unsigned, unsigned>> widths = {
+        {0, 0}, {4, 4}, {8, 8}, {12, 12}, {16, 16}, {0, 16}};
+
+    struct Config { const char* name; unsigned bottom, top; };
+    vector<Config> configs = {
+        {"prefix_bloom_8", 8, 8},
+        {"rosetta_0_8", 0, 8},
+        {"rosetta_0_16", 0, 16},
+    };
+
+    for (unsigned key_bits : {32u, 64u}) {
+        auto keys = make_keys(n, 8101);
+        if (key_bits < 64) for (auto &k : keys) k &= (1ULL << key_bits) - 1;
+        vector<uint64_t> sorted = keys;
+        sort(sorted.begin(), sorted.end());
+
+        for (const auto &cfg : configs) {
+            RangeBloomFilter rf(n, target_fpr, cfg.bottom, cfg.top);
+            for (auto k : keys) rf.insert(k);
+            double bpe = bits_per_entry(rf, n);
+
+            unsigned limit = cfg.top +
+                (unsigned)__builtin_ctzll(RangeBloomFilter::MAX_TOP_PROBES);
+            for (auto [wmin, wmax] : widths) {
+                if (wmin > limit) continue;
+                wmax = min(wmax, limit);
+                auto qs = make_range_queries(sorted, n_queries, wmin, wmax,
+                                             0.9, key_bits, 8102 + wmin);
+                size_t empty = 0, fp = 0, fn = 0, probes = 0;
+                for (const auto &q : qs) {
+                    bool hit = rf.may_contain_range(q.lo, q.hi, &probes);
+                    if (!q.nonempty) {
+                        empty++;
+                        fp += hit;
+                    } else {
+                        fn += !hit;
+                    }
+                }
+
+                vector<double> ops_ps;
+                for (int t = 0; t < g_trials; ++t) {
+                    size_t hits = 0;
+                    double ms = time_ms([&] {
+                        for (const auto &q : qs) {
+                            hits += rf.may_contain_range(q.lo, q.hi);
+                        }
+                    });
+                    volatile size_t sink = hits;
+                    (void)sink;
+                    ops_ps.push_back((double)qs.size() / (ms * 1e-3));
                 }
+
+                string wname = wmin == wmax
+                    ? to_string(1ULL << wmin) : string("mixed");
+                cout << cfg.name << ","
+                     << n << ","
+                     << key_bits << ","
+                     << target_fpr << ","
+                     << bpe << ","
+                     << wname << ","
+                     << qs.size() << ","
+                     << empty << ","
+                     << (empty ? (double)fp / (double)empty : 0.0) << ","
+                     << fn << ","
+                     << mean_vec(ops_ps) << ","
+                     << stddev_vec(ops_ps) << ","
+                     << (double)probes / (double)max<size_t>(1, qs.size())
+                     << "\n";
             }
         }
     }
 }
 
+// ------------------- Page Backing: 4 KiB vs Huge Pages -------------------
+//
+// The same lookups against tables mapped under each --pages policy in
+// turn. pages_obtained is what map_table actually got, since a request
+// falls back silently. huge_mb is how much more of the process sits on
+// huge pages once the filter is filled. The perf columns are always on
+// here; dtlb_misses_per_op is the one this sweep is about.
+
+template<typename Make>
+void page_rows(const string &name, size_t n, Make &&make,
+               const vector<Op> &ops)
+{
+    for (PageBacking req : {PageBacking::NORMAL, PageBacking::THP,
+                            PageBacking::HUGETLB}) {
+        g_page_policy = req;
+        page_stats_reset();
+        long kb0 = huge_page_kb();
+        auto f = make();
+        long kb1 = huge_page_kb();
+        if (!f) continue;
+        double huge_mb = (kb0 < 0 || kb1 < 0) ? (double)NAN
+                                              : (kb1 - kb0) / 1024.0;
+
+        vector<double> ops_ps;
+        PerfCounters pc(true);
+        for (int t = 0; t < g_trials; ++t) {
+            RunResult rr = pc.measure([&] {
+                return run_workload(*f, ops, false);
+            });
+            ops_ps.push_back(rr.ops_per_sec);
+        }
+        cout << name << ","
+             << n << ","
+             << page_backing_str(req) << ","
+             << page_backing_obtained() << ","
+             << f->bytes_used() / 1e6 << ","
+             << huge_mb << ","
+             << mean_vec(ops_ps) << ","
+             << stddev_vec(ops_ps) << ",";
+        pc.write_csv(cout, (double)ops.size() * g_trials);
+        cout << "\n";
+    }
+}
+
+void run_page_sweep() {
+    cout << "filter,n,pages_requested,pages_obtained,table_mb,huge_mb,"
+            "ops_per_sec_mean,ops_per_sec_std,"
+         << PerfCounters::csv_header() << "\n";
+
+    PageBacking saved = g_page_policy;
+    double target_fpr = 0.01;
+    for (size_t n : {1000000, 10000000}) {
+        auto pos = make_keys(n, 9001);
+        auto neg = make_keys(n, 9002);
+        auto ops = make_workload(2000000, WorkloadType::READ_ONLY, 0.5,
+                                 pos, neg);
+
+        page_rows("bloom_blocked", n, [&] {
+            auto f = make_unique<BlockedBloomFilter>(n, target_fpr);
+            for (auto k : pos) f->insert(k);
+            return f;
+        }, ops);
+        page_rows("cuckoo", n, [&] {
+            auto f = make_unique<CuckooFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        }, ops);
+        page_rows("quotient", n, [&] {
+            auto f = make_unique<QuotientFilter>(n, target_fpr, 8);
+            for (auto k : pos) f->insert(k);
+            return f;
+        }, ops);
+        page_rows("xor", n, [&] {
+            auto f = make_unique<XORFilter>(n, target_fpr, 8);
+            if (!f->build(pos)) f.reset();
+            return f;
+        }, ops);
+    }
+    g_page_policy = saved;
+}
+
+// ------------------- Churn: Tombstones vs Compaction -------------------
+
+// Holds the linear quotient filter at a fixed live load while every insert
+// retires the oldest key, and samples lookup latency after each epoch. The
+// plain variant only ever reuses tombstones, so empty slots disappear and
+// misses probe ever further; the compacting one reclaims them. At the end
+// the plain filter is compacted once and measured again.
+void run_churn_bench() {
+    cout << "filter,table_size,live_load,epoch,churn_ops,phase,"
+            "occupancy,tombstone_frac,compactions,churn_ops_per_sec,"
+            "lookup_ns_per_op,p50_ns,p99_ns\n";
+
+    size_t n = 800'000;       // a 2^20-slot table
+    double target_fpr = 0.01;
+    double live_load = 0.7;
+    int epochs = 24;
+
+    for (bool compacting : {false, true}) {
+        const char *name = compacting ? "quotient_compacting"
+                                      : "quotient_tombstones";
+        QuotientFilter qf(n, target_fpr, 8);
+        qf.compaction = compacting;
+        size_t T = qf.capacity();
+        size_t live = (size_t)(live_load * (double)T);
+        size_t per_epoch = T / 8;
+
+        auto keys = make_keys(live + (size_t)epochs * per_epoch, 777);
+        auto neg = make_keys(200000, 778);
+        for (size_t i = 0; i < live; ++i) qf.insert(keys[i]);
+
+        size_t head = 0, tail = live;  // live window is keys[head, tail)
+        auto sample = [&](int epoch, const char *phase, double churn_ops_s) {
+            vector<uint64_t> hits(keys.begin() + head, keys.begin() + tail);
+            auto ops = make_workload(200000, WorkloadType::READ_ONLY, 0.5,
+                                     hits, neg);
+            RunResult rr = run_workload(qf, ops, false);
+            cout << name << ","
+                 << T << ","
+                 << live_load << ","
+                 << epoch << ","
+                 << (size_t)epoch * per_epoch << ","
+                 << phase << ","
+                 << (double)(qf.n_live + qf.n_tomb) / T << ","
+                 << (double)qf.n_tomb / T << ","
+                 << qf.compactions << ","
+                 << churn_ops_s << ","
+                 << rr.ns_per_op << ","
+                 << rr.p50_ns << ","
+                 << rr.p99_ns
+                 << "\n";
+        };
+
+        sample(0, "churn", 0.0);
+        for (int e = 1; e <= epochs; ++e) {
+            double ms = time_ms([&] {
+                for (size_t i = 0; i < per_epoch; ++i) {
+                    qf.erase(keys[head++]);
+                    qf.insert(keys[tail++]);
+                }
+            });
+            sample(e, "churn", per_epoch / (ms * 1e-3));
+        }
+        if (!compacting) {
+            qf.compact();
+            sample(epochs, "after_compact", 0.0);
+        }
+    }
+}
+
+// ------------------- Counting: CQF vs unordered_map -------------------
+
+// Multiset counting over Zipf-skewed streams. The counting RSQF is sized
+// for the slots its counters need given the true multiplicities (worst-case
+// encoding per key); the map is the exact baseline, charged for its bucket
+// array plus one 24-byte node (next pointer, key, count) and an 8-byte
+// malloc header per distinct key.
+void run_counting_bench() {
+    cout << "structure,zipf_s,universe,stream,distinct,"
+            "insert_ops_per_sec_mean,insert_ops_per_sec_std,"
+            "query_ops_per_sec_mean,query_ops_per_sec_std,"
+            "bytes,bytes_per_distinct,slots_used,failures,"
+            "exact_frac,mean_overcount\n";
+
+    size_t universe = 1'000'000;
+    size_t stream_len = 10'000'000;
+    vector<double> skews = {0.8, 1.0, 1.2, 1.5};
+
+    for (double s : skews) {
+        ZipfGenerator zipf(universe, s, 4242);
+        vector<uint64_t> stream(stream_len);
+        for (auto &k : stream) k = hash64(zipf.next(), 0xc0ffee);
+        vector<uint64_t> queries(stream.begin(),
+                                 stream.begin() + stream_len / 10);
+
+        unordered_map<uint64_t, uint64_t> truth;
+        for (auto k : stream) truth[k]++;
+        size_t need = 0;
+        {
+            RankSelectQuotientFilter probe(1, 0.01, 8, 5, true);
+            uint64_t enc[RankSelectQuotientFilter::MAX_ENC];
+            // remainder 1 forces the leading-zero form, the longest one
+            for (auto &kv : truth) need += probe.encode_count(1, kv.second, enc);
+        }
 
+        vector<double> m_ins, m_qry, c_ins, c_qry;
+        size_t c_bytes = 0, c_slots = 0, c_fail = 0;
+        size_t exact = 0;
+        double over = 0.0;
+        volatile uint64_t sink = 0;
+
+        for (int t = 0; t < g_trials; ++t) {
+            unordered_map<uint64_t, uint64_t> m;
+            double ins_ms = time_ms([&] { for (auto k : stream) m[k]++; });
+            uint64_t acc = 0;
+            double qry_ms = time_ms([&] {
+                for (auto k : queries) {
+                    auto it = m.find(k);
+                    acc += it == m.end() ? 0 : it->second;
+                }
+            });
+            sink = sink + acc;
+            m_ins.push_back(stream.size() / (ins_ms * 1e-3));
+            m_qry.push_back(queries.size() / (qry_ms * 1e-3));
+
+            RankSelectQuotientFilter cq(need, 0.01, 8, 5, true);
+            size_t fails = 0;
+            ins_ms = time_ms([&] {
+                for (auto k : stream) fails += !cq.insert(k);
+            });
+            acc = 0;
+            qry_ms = time_ms([&] {
+                for (auto k : queries) acc += cq.count(k);
+            });
+            sink = sink + acc;
+            c_ins.push_back(stream.size() / (ins_ms * 1e-3));
+            c_qry.push_back(queries.size() / (qry_ms * 1e-3));
+
+            if (t == 0) {
+                c_bytes = cq.bytes_used();
+                c_slots = cq.n_items;
+                c_fail = fails;
+                for (auto &kv : truth) {
+                    uint64_t c = cq.count(kv.first);
+                    exact += c == kv.second;
+                    over += (double)c - (double)kv.second;
+                }
+            }
+        }
 
+        size_t distinct = truth.size();
+        size_t m_bytes = truth.bucket_count() * sizeof(void*) + distinct * 32;
+        auto row = [&](const char *name, const vector<double> &ins,
+                       const vector<double> &qry, size_t bytes, size_t slots,
+                       size_t fails, double exact_frac, double overcount) {
+            cout << name << ","
+                 << s << ","
+                 << universe << ","
+                 << stream_len << ","
+                 << distinct << ","
+                 << mean_vec(ins) << ","
+                 << stddev_vec(ins) << ","
+                 << mean_vec(qry) << ","
+                 << stddev_vec(qry) << ","
+                 << bytes << ","
+                 << (double)bytes / distinct << ","
+                 << slots << ","
+                 << fails << ","
+                 << exact_frac << ","
+                 << overcount
+                 << "\n";
+        };
+        row("unordered_map", m_ins, m_qry, m_bytes, distinct, 0, 1.0, 0.0);
+        row("cqf", c_ins, c_qry, c_bytes, c_slots, c_fail,
+            (double)exact / distinct, over / distinct);
+    }
+}
 
 // ------------------- Full Experiments Wrapper -------------------
 
@@ -1339,10 +7619,39 @@ int main(int argc, char** argv) {
             mode = arg.substr(strlen("--mode="));
         } else if (arg.rfind("--trials=", 0) == 0) {
             g_trials = stoi(arg.substr(strlen("--trials=")));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            g_build_threads = stoi(arg.substr(strlen("--threads=")));
+        } else if (arg.rfind("--dir=", 0) == 0) {
+            g_persist_dir = arg.substr(strlen("--dir="));
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            g_batch = (size_t)max(0, stoi(arg.substr(strlen("--batch="))));
+        } else if (arg.rfind("--sample=", 0) == 0) {
+            g_sample_every = (size_t)max(1, stoi(arg.substr(strlen("--sample="))));
+        } else if (arg.rfind("--clients=", 0) == 0) {
+            g_clients = stoi(arg.substr(strlen("--clients=")));
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            g_trace_path = arg.substr(strlen("--trace="));
+        } else if (arg.rfind("--span=", 0) == 0) {
+            g_sample_span = (size_t)max(1, stoi(arg.substr(strlen("--span="))));
+        } else if (arg == "--perf") {
+            g_perf = true;
+        } else if (arg.rfind("--placement=", 0) == 0) {
+            if (!parse_placement(arg.substr(strlen("--placement=")), g_placement)) {
+                cerr << "Bad placement: " << arg << "\n";
+                return 1;
+            }
+            g_placement_set = true;
+        } else if (arg.rfind("--pages=", 0) == 0) {
+            if (!parse_page_backing(arg.substr(strlen("--pages=")),
+                                    g_page_policy)) {
+                cerr << "Bad page backing: " << arg << "\n";
+                return 1;
+            }
         }
     }
 
     if (g_trials < 1) g_trials = 1;
+    if (g_build_threads < 1) g_build_threads = 1;
 
     if (mode == "sanity") {
         sanity_tests();
@@ -1354,13 +7663,40 @@ int main(int argc, char** argv) {
         run_thread_scaling();
     } else if (mode == "space") {
         run_space_accuracy_sweep();
+    } else if (mode == "build") {
+        run_build_scaling();
+    } else if (mode == "batch") {
+        run_batch_sweep();
+    } else if (mode == "persist") {
+        run_persist_bench();
+    } else if (mode == "counting") {
+        run_counting_bench();
+    } else if (mode == "churn") {
+        run_churn_bench();
+    } else if (mode == "adaptive") {
+        run_adaptive_bench();
+    } else if (mode == "range") {
+        run_range_sweep();
+    } else if (mode == "pages") {
+        run_page_sweep();
+    } else if (mode == "skew") {
+        run_skew_sweep();
+    } else if (mode == "trace") {
+        run_trace_replay();
+    } else if (mode == "open_loop") {
+        run_open_loop_sweep();
     } else if (mode == "full") {
         run_full_experiments();
     } else {
         cerr << "Unknown mode: " << mode << "\n";
         cerr << "Usage: " << argv[0]
-             << " --mode={sanity|simple_sweep|dynamic|threaded|space|full}"
-             << " [--trials=K]\n";
+             << " --mode={sanity|simple_sweep|dynamic|threaded|space|build|"
+                "batch|persist|counting|churn|adaptive|range|pages|skew|trace|"
+                "open_loop|full}"
+             << " [--trials=K] [--threads=K] [--batch=K] [--dir=PATH]"
+                " [--sample=N] [--span=K] [--trace=PATH] [--clients=K]"
+                " [--perf] [--pages={normal|thp|hugetlb}]"
+                " [--placement={none|compact|scatter|smt_first|CPU,LIST}]\n";
         return 1;
     }
 
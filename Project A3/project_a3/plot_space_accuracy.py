@@ -19,6 +19,7 @@ colors = {
     "cuckoo":        "tab:orange",
     "quotient":      "tab:green",
     "xor":           "tab:red",
+    "ribbon128":     "tab:purple",
 }
 
 # --------------------------------------------------
@@ -29,7 +30,7 @@ def plot_space_vs_accuracy(agg_df, n_value):
 
     plt.figure(figsize=(9, 5))
 
-    for filt in ["bloom_blocked", "cuckoo", "quotient", "xor"]:
+    for filt in ["bloom_blocked", "cuckoo", "quotient", "xor", "ribbon128"]:
         fdf = sub[sub["filter"] == filt].sort_values("bpe")
         if fdf.empty:
             continue